@@ -0,0 +1,149 @@
+// Workgroup-cooperative traversal: lanes walk the occupancy pyramid on their own down to brick
+// level, then the workgroup agrees on one brick per round, loads it into shared memory once and
+// every lane waiting on that brick marches it from there. Requires trace.glsl, and must be called
+// from uniform control flow since it contains barriers. The including shader declares its local
+// size first.
+#if defined(SUBGROUP_OPS)
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
+
+const int BrickLevel = 3;
+const int BrickSize = 1 << BrickLevel;
+const uint BrickVolume = uint(BrickSize * BrickSize * BrickSize);
+const uint NoBrick = 0xFFFFFFFFu;
+
+// Rays still searching after this many rounds finish with the per-lane hierarchical DDA.
+const int MaxBrickRounds = 32;
+
+shared int brickCells[BrickVolume];
+shared uint requestedBrick;
+
+uint brickId(ivec3 brick) {
+    return uint(brick.x) | (uint(brick.y) << 10) | (uint(brick.z) << 20);
+}
+
+ivec3 brickOrigin(uint id) {
+    return ivec3(id & 0x3FFu, (id >> 10) & 0x3FFu, id >> 20) * BrickSize;
+}
+
+// Skips empty space with the pyramid until the ray enters an occupied brick. Returns false once
+// it leaves the grid.
+bool findBrick(vec3 origin, vec3 dir, vec3 invDir, float tExit, inout float t, out ivec3 brick) {
+    brick = ivec3(0);
+    int level = PYRAMID_LEVELS;
+    for (int i = 0; i < MaxDDASteps && t < tExit; i++) {
+        ivec3 cell = ivec3(clampPosition(origin + t*dir));
+        ivec3 levelCell = cell >> level;
+
+        if (occupied(level, levelCell)) {
+            if (level == BrickLevel) {
+                brick = levelCell;
+                return true;
+            }
+
+            level--;
+            continue;
+        }
+
+        vec3 boxMin = vec3(levelCell << level);
+        vec3 boxMax = boxMin + float(1 << level);
+        t = max(exitBox(origin, dir, invDir, boxMin, boxMax), t) + 1e-4;
+        level = min(level + 1, PYRAMID_LEVELS);
+    }
+
+    return false;
+}
+
+// The lowest requested brick id wins the round.
+uint selectBrick(uint wanted) {
+    if (gl_LocalInvocationIndex == 0u) {
+        requestedBrick = NoBrick;
+    }
+    barrier();
+
+#if defined(SUBGROUP_OPS)
+    // One shared atomic per subgroup rather than per lane.
+    uint subgroupWanted = subgroupMin(wanted);
+    if (subgroupElect() && subgroupWanted != NoBrick) {
+        atomicMin(requestedBrick, subgroupWanted);
+    }
+#else
+    if (wanted != NoBrick) {
+        atomicMin(requestedBrick, wanted);
+    }
+#endif
+    barrier();
+
+    return requestedBrick;
+}
+
+// The workgroup fetches the brick once, each lane reading a strided share of its cells.
+void loadBrick(uint id) {
+    ivec3 base = brickOrigin(id);
+    uint groupSize = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+    for (uint i = gl_LocalInvocationIndex; i < BrickVolume; i += groupSize) {
+        ivec3 cell = base + ivec3(i % BrickSize, (i / BrickSize) % BrickSize, i / (BrickSize * BrickSize));
+        brickCells[i] = all(lessThan(cell, ivec3(WIDTH, HEIGHT, DEPTH))) ? voxelAt(cell) : 0;
+    }
+    barrier();
+}
+
+// Walks the loaded brick one cell at a time. On a miss t is left where the ray exits the brick.
+bool marchBrick(vec3 origin, vec3 dir, vec3 invDir, ivec3 brick, inout float t, out vec3 pos) {
+    ivec3 base = brick * BrickSize;
+    for (int i = 0; i < 3 * BrickSize; i++) {
+        pos = origin + t*dir;
+        ivec3 cell = ivec3(clampPosition(pos));
+        ivec3 local = cell - base;
+        if (any(lessThan(local, ivec3(0))) || any(greaterThanEqual(local, ivec3(BrickSize)))) {
+            return false;
+        }
+
+        if (brickCells[local.x + local.y * BrickSize + local.z * BrickSize * BrickSize] != 0) {
+            return true;
+        }
+
+        t = max(exitBox(origin, dir, invDir, vec3(cell), vec3(cell) + 1.0), t) + 1e-4;
+    }
+
+    return false;
+}
+
+// Every lane of the workgroup must call this; lanes without a ray pass active = false.
+bool traceCooperative(bool active, vec3 origin, vec3 dir, float tMax, out vec3 pos) {
+    vec3 invDir = safeInverse(dir);
+
+    float tEnter, tExit;
+    clipToGrid(origin, invDir, tMax, tEnter, tExit);
+
+    pos = origin;
+    float t = tEnter + 1e-4;
+    ivec3 brick;
+    bool searching = active && findBrick(origin, dir, invDir, tExit, t, brick);
+
+    bool hit = false;
+    for (int i = 0; i < MaxBrickRounds; i++) {
+        uint wanted = searching ? brickId(brick) : NoBrick;
+        uint selected = selectBrick(wanted);
+        if (selected == NoBrick) {
+            break;
+        }
+
+        loadBrick(selected);
+
+        if (wanted == selected) {
+            hit = marchBrick(origin, dir, invDir, brick, t, pos);
+            searching = !hit && findBrick(origin, dir, invDir, tExit, t, brick);
+        }
+
+        // Nobody may overwrite the brick while another lane is still marching it.
+        barrier();
+    }
+
+    if (searching) {
+        return marchHierarchicalDDA(origin + t*dir, dir, tMax - t, pos);
+    }
+
+    return hit;
+}
@@ -0,0 +1,45 @@
+struct CameraData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 origin;
+    vec4 rayCorner;
+    vec4 rayDx;
+    vec4 rayDy;
+};
+
+#ifdef FRAME_BINDING
+// Written by the host once per frame in flight; see FrameConstants in camera.h.
+layout (set = 0, binding = FRAME_BINDING, std140) uniform FrameConstants {
+    CameraData camera;
+    CameraData prevCamera;
+    ivec2 screenSize;
+    uint frameIndex;
+    uint instanceCount;
+    uint sceneNodes;
+    uint sceneInstances;
+} Frame;
+
+void cameraRay(ivec2 loc, out vec3 origin, out vec3 dir) {
+    origin = Frame.camera.origin.xyz;
+    dir = normalize(Frame.camera.rayCorner.xyz + float(loc.x) * Frame.camera.rayDx.xyz + float(loc.y) * Frame.camera.rayDy.xyz);
+}
+#endif
+
+// Inverse of cameraRay: finds the pixel position a world point lands on, which may be off screen.
+// False when the point is behind the camera and has no position.
+bool cameraProject(mat4 viewProjection, vec3 worldPos, ivec2 size, out vec2 pixel) {
+    vec4 clip = viewProjection * vec4(worldPos, 1.0);
+    pixel = vec2(0.0);
+    if (clip.w <= 0.0) {
+        return false;
+    }
+
+    pixel = (clip.xy / clip.w * 0.5 + 0.5) * vec2(size) - 0.5;
+    return true;
+}
+
+vec3 skyColor(vec3 dir) {
+    float a = 0.5 * (dir.y + 1);
+    return (1.0 - a)*vec3(1.0) + a*vec3(0.5, 0.7, 1.0);
+}
@@ -0,0 +1,39 @@
+const int WIDTH = 64;
+const int HEIGHT = 64;
+const int DEPTH = 64;
+
+uint positionToIndex(uvec3 pos) {
+    return pos.x + pos.y * WIDTH + pos.z * WIDTH * HEIGHT;
+}
+
+bool insideGrid(ivec3 pos) {
+    return all(greaterThanEqual(pos, ivec3(0))) && all(lessThan(pos, ivec3(WIDTH, HEIGHT, DEPTH)));
+}
+
+const int PYRAMID_LEVELS = 6;
+
+// Bit 0 of a pyramid cell is set when anything below it is occupied. The upper bits hold the cell's
+// LOD material: the most common material among its solid children, or 0 when fewer than half are solid.
+const uint PyramidOccupiedBit = 1u;
+const int PyramidMaterialShift = 8;
+
+uint pyramidMaterial(uint cell) {
+    return cell >> PyramidMaterialShift;
+}
+
+ivec3 pyramidLevelSize(int level) {
+    return max(ivec3(WIDTH, HEIGHT, DEPTH) >> level, ivec3(1));
+}
+
+uint pyramidIndex(int level, ivec3 cell) {
+    uint offset = 0;
+    for (int l = 1; l < level; l++) {
+        ivec3 size = pyramidLevelSize(l);
+        offset += uint(size.x * size.y * size.z);
+    }
+
+    ivec3 size = pyramidLevelSize(level);
+    return offset + uint(cell.x + cell.y * size.x + cell.z * size.x * size.y);
+}
+
+const vec3 SunDirection = normalize(vec3(0.4, 0.8, 0.3));
@@ -0,0 +1,9 @@
+// Indirect dispatches may be split across X and Y to stay under maxComputeWorkGroupCount,
+// so 1D kernels launched indirectly must flatten the group index themselves.
+uint flatWorkGroupIndex() {
+    return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+}
+
+uint flatInvocationIndex(uint groupSize) {
+    return flatWorkGroupIndex() * groupSize + gl_LocalInvocationID.x;
+}
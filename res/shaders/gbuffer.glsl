@@ -0,0 +1,22 @@
+// G-buffer texel: x = ray distance bits, y = face | material << 8. Material 0 means the ray missed.
+uvec4 packGBuffer(float depth, uint face, uint material) {
+    return uvec4(floatBitsToUint(depth), face | (material << 8), 0u, 0u);
+}
+
+float gbufferDepth(uvec4 texel) {
+    return uintBitsToFloat(texel.x);
+}
+
+uint gbufferFace(uvec4 texel) {
+    return texel.y & 0x7u;
+}
+
+uint gbufferMaterial(uvec4 texel) {
+    return texel.y >> 8;
+}
+
+vec3 faceNormal(uint face) {
+    vec3 normal = vec3(0.0);
+    normal[face >> 1] = (face & 1u) != 0u ? -1.0 : 1.0;
+    return normal;
+}
@@ -0,0 +1,15 @@
+// Palettes live in the bindless heap (set 1) and are selected by a handle from push constants.
+struct Material {
+    vec4 albedo;
+    vec4 emission;
+    vec4 params;
+};
+
+layout (set = 1, binding = 0, std430) readonly buffer MaterialPalette {
+    Material materials[];
+} materialPalettes[];
+
+Material loadMaterial(uint palette, uint materialId) {
+    uint count = uint(materialPalettes[palette].materials.length());
+    return materialPalettes[palette].materials[min(materialId, count - 1u)];
+}
@@ -0,0 +1,18 @@
+#version 450 core
+
+#extension GL_GOOGLE_include_directive : require
+
+#define FRAME_BINDING 0
+#include "camera.glsl"
+#include "gbuffer.glsl"
+
+layout (location = 0) in vec3 worldPos;
+layout (location = 1) flat in uint faceMaterial;
+
+layout (location = 0) out uvec2 gbuffer;
+
+void main() {
+    // Depth is the distance along the primary ray, as the march pass stores it.
+    float depth = distance(worldPos, Frame.camera.origin.xyz);
+    gbuffer = packGBuffer(depth, faceMaterial & 7u, faceMaterial >> 3).xy;
+}
@@ -0,0 +1,26 @@
+#version 450 core
+
+#extension GL_GOOGLE_include_directive : require
+
+#define FRAME_BINDING 0
+#include "camera.glsl"
+
+// Packed as in mesher.h: chunk-local corner (5 bits per axis), face, then material from bit 18.
+layout (location = 0) in uint vertex;
+
+layout (location = 0) out vec3 worldPos;
+layout (location = 1) flat out uint faceMaterial;
+
+layout (push_constant) uniform constants {
+    ivec4 chunkOrigin;
+} PushConstants;
+
+void main() {
+    uvec3 corner = uvec3(vertex, vertex >> 5, vertex >> 10) & 31u;
+    worldPos = vec3(PushConstants.chunkOrigin.xyz + ivec3(corner));
+    faceMaterial = vertex >> 15;
+
+    gl_Position = Frame.camera.viewProjection * vec4(worldPos, 1.0);
+    // The projection maps depth to [-w, w]; Vulkan clips to [0, w].
+    gl_Position.z = 0.5 * (gl_Position.z + gl_Position.w);
+}
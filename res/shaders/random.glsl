@@ -0,0 +1,28 @@
+uint pcgHash(inout uint state) {
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float randomFloat(inout uint state) {
+    return float(pcgHash(state)) / 4294967296.0;
+}
+
+uint randomSeed(ivec2 loc, uint frameIndex) {
+    uint state = uint(loc.x) * 1973u + uint(loc.y) * 9277u + frameIndex * 26699u;
+    pcgHash(state);
+    return state;
+}
+
+vec3 cosineHemisphere(vec3 normal, inout uint state) {
+    float u = randomFloat(state);
+    float v = randomFloat(state);
+
+    float r = sqrt(u);
+    float phi = 6.28318530718 * v;
+
+    vec3 tangent = normalize(abs(normal.y) < 0.99 ? cross(normal, vec3(0.0, 1.0, 0.0)) : cross(normal, vec3(1.0, 0.0, 0.0)));
+    vec3 bitangent = cross(normal, tangent);
+
+    return normalize(tangent * r * cos(phi) + bitangent * r * sin(phi) + normal * sqrt(1.0 - u));
+}
@@ -0,0 +1,106 @@
+// Instanced scenes: a BVH over instance bounds, each instance marching its model's box of the shared
+// grid in model space. Requires trace.glsl, gbuffer.glsl and camera.glsl with FRAME_BINDING. The BVH
+// lives in the bindless heap (set 1) and Frame.instanceCount is 0 when the scene has no instances.
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct SceneNode {
+    vec3 min;
+    uint first;
+    vec3 max;
+    uint count;
+};
+
+// regionMin.w holds the instance's handle.
+struct SceneInstance {
+    mat4 worldToLocal;
+    ivec4 regionMin;
+    ivec4 regionMax;
+};
+
+layout (set = 1, binding = 0, std430) readonly buffer SceneNodes {
+    SceneNode nodes[];
+} sceneNodes[];
+
+layout (set = 1, binding = 0, std430) readonly buffer SceneInstances {
+    SceneInstance instances[];
+} sceneInstances[];
+
+// Mirrors scenebvh.h; BuildSceneBvh asserts the tree fits.
+const int SceneStackSize = 32;
+
+struct SceneHit {
+    float t;
+    uint face;
+    uint material;
+    uint instance;
+    // Voxel of the shared grid that was hit, at full resolution even for LOD hits.
+    ivec3 voxel;
+};
+
+bool hitBounds(vec3 origin, vec3 invDir, vec3 boxMin, vec3 boxMax, float tMax) {
+    float tEnter, tExit;
+    clipToBox(origin, invDir, boxMin, boxMax, tMax, tEnter, tExit);
+    return tEnter <= tExit;
+}
+
+// Faces are axis aligned in model space; a rotated instance reports the world axis nearest its normal.
+uint worldFace(mat4 worldToLocal, uint localFace) {
+    vec3 normal = transpose(mat3(worldToLocal)) * faceNormal(localFace);
+    vec3 a = abs(normal);
+    uint axis = a.x > a.y ? (a.x > a.z ? 0u : 2u) : (a.y > a.z ? 1u : 2u);
+    return axis * 2u + (normal[axis] < 0.0 ? 1u : 0u);
+}
+
+// Closest hit over all instances. The model-space direction is left unnormalised so t means the same
+// distance in both spaces, and the footprint is scaled into model voxels with it.
+bool traceScene(vec3 origin, vec3 dir, float tMax, float footprint, out SceneHit hit) {
+    hit.t = tMax;
+    hit.face = 0u;
+    hit.material = 0u;
+    hit.instance = 0u;
+    hit.voxel = ivec3(0);
+
+    vec3 invDir = safeInverse(dir);
+    bool found = false;
+
+    uint stack[SceneStackSize];
+    int top = 0;
+    stack[top++] = 0u;
+    while (top > 0) {
+        SceneNode node = sceneNodes[Frame.sceneNodes].nodes[stack[--top]];
+        if (!hitBounds(origin, invDir, node.min, node.max, hit.t)) {
+            continue;
+        }
+
+        if (node.count == 0u) {
+            if (top + 2 <= SceneStackSize) {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1u;
+            }
+            continue;
+        }
+
+        for (uint i = node.first; i < node.first + node.count; i++) {
+            SceneInstance instance = sceneInstances[Frame.sceneInstances].instances[i];
+            vec3 regionMin = vec3(instance.regionMin.xyz);
+            vec3 localOrigin = (instance.worldToLocal * vec4(origin, 1.0)).xyz + regionMin;
+            vec3 localDir = mat3(instance.worldToLocal) * dir;
+
+            vec3 pos;
+            int level;
+            if (!marchRegion(localOrigin, localDir, hit.t, footprint * length(localDir), regionMin, vec3(instance.regionMax.xyz), pos, level)) {
+                continue;
+            }
+
+            hit.voxel = clamp(ivec3(floor(pos)), instance.regionMin.xyz, instance.regionMax.xyz - 1);
+            ivec3 cell = hit.voxel >> level;
+            hit.t = dot(pos - localOrigin, localDir) / dot(localDir, localDir);
+            hit.face = worldFace(instance.worldToLocal, hitFace(pos / float(1 << level), localDir, cell));
+            hit.material = lodMaterial(level, cell);
+            hit.instance = uint(instance.regionMin.w);
+            found = true;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,176 @@
+// Requires VOXEL_BINDING (or VOXEL_ADDRESS), DISTANCE_BINDING and PYRAMID_BINDING to be defined before inclusion.
+#include "voxels.glsl"
+
+layout (set = 0, binding = DISTANCE_BINDING, std430) readonly buffer DistanceData {
+    int distances[];
+};
+
+layout (set = 0, binding = PYRAMID_BINDING, std430) readonly buffer PyramidData {
+    uint pyramid[];
+};
+
+const int MarchFixedStep = 0;
+const int MarchSphereTrace = 1;
+const int MarchHierarchicalDDA = 2;
+const int MarchBrickCooperative = 3;
+
+const int MaxDDASteps = 512;
+
+// Coarsest pyramid level the LOD traversal may stop at.
+const int MaxLodLevel = 3;
+
+uvec3 clampPosition(vec3 pos) {
+    return uvec3(clamp(ivec3(floor(pos)), ivec3(0), ivec3(WIDTH - 1, HEIGHT - 1, DEPTH - 1)));
+}
+
+vec3 safeInverse(vec3 dir) {
+    return 1.0 / mix(dir, vec3(1e-6), lessThan(abs(dir), vec3(1e-6)));
+}
+
+void clipToBox(vec3 origin, vec3 invDir, vec3 boxMin, vec3 boxMax, float tMax, out float tEnter, out float tExit) {
+    vec3 t0 = (boxMin - origin) * invDir;
+    vec3 t1 = (boxMax - origin) * invDir;
+    vec3 tNear = min(t0, t1);
+    vec3 tFar = max(t0, t1);
+    tEnter = max(max(tNear.x, tNear.y), max(tNear.z, 0.0));
+    tExit = min(min(tFar.x, tFar.y), min(tFar.z, tMax));
+}
+
+void clipToGrid(vec3 origin, vec3 invDir, float tMax, out float tEnter, out float tExit) {
+    clipToBox(origin, invDir, vec3(0.0), vec3(WIDTH, HEIGHT, DEPTH), tMax, tEnter, tExit);
+}
+
+float exitBox(vec3 origin, vec3 dir, vec3 invDir, vec3 boxMin, vec3 boxMax) {
+    vec3 tBox = (mix(boxMin, boxMax, greaterThan(dir, vec3(0.0))) - origin) * invDir;
+    return min(min(tBox.x, tBox.y), tBox.z);
+}
+
+bool marchFixedStep(vec3 origin, vec3 dir, float tMax, out vec3 pos) {
+    for (float t = 0.0; t < tMax; t += 0.1) {
+        pos = origin + t*dir;
+        uvec3 cPos = clampPosition(pos);
+        bool inside = pos.x >= 0 && pos.y >= 0 && pos.z >= 0;
+        if (voxelAt(ivec3(cPos)) != 0 && inside) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool marchSphereTrace(vec3 origin, vec3 dir, float tMax, out vec3 pos) {
+    vec3 invDir = safeInverse(dir);
+
+    float tEnter, tExit;
+    clipToGrid(origin, invDir, tMax, tEnter, tExit);
+
+    pos = origin;
+    float t = tEnter + 1e-4;
+    while (t < tExit) {
+        pos = origin + t*dir;
+        ivec3 cell = ivec3(clampPosition(pos));
+        int dist = distances[positionToIndex(uvec3(cell))];
+        if (dist == 0) {
+            return true;
+        }
+
+        // Every cell within (dist - 1) of this one is empty, so skip to the exit of that box.
+        vec3 boxMin = vec3(cell - (dist - 1));
+        vec3 boxMax = vec3(cell + dist);
+        t = max(exitBox(origin, dir, invDir, boxMin, boxMax), t) + 1e-4;
+    }
+
+    return false;
+}
+
+bool occupied(int level, ivec3 cell) {
+    if (level == 0) {
+        return voxelAt(cell) != 0;
+    }
+
+    return (pyramid[pyramidIndex(level, cell)] & PyramidOccupiedBit) != 0u;
+}
+
+uint lodMaterial(int level, ivec3 cell) {
+    if (level == 0) {
+        return uint(voxelAt(cell));
+    }
+
+    return pyramidMaterial(pyramid[pyramidIndex(level, cell)]);
+}
+
+// Coarsest level whose cells are no wider than the ray's footprint at distance t.
+int lodLevel(float t, float footprint) {
+    return clamp(int(floor(log2(max(t * footprint, 1.0)))), 0, MaxLodLevel);
+}
+
+// Hierarchical DDA that stops descending once pyramid cells are narrower than the ray's footprint
+// and treats them as solid or empty by their LOD material. footprint is the ray's width per unit of
+// distance; 0 walks down to voxels. hitLevel is the level of the cell that was hit. Only voxels inside
+// [boxMin, boxMax) can be hit, which is how instances read their model out of the shared grid.
+bool marchRegion(vec3 origin, vec3 dir, float tMax, float footprint, vec3 boxMin, vec3 boxMax, out vec3 pos, out int hitLevel) {
+    vec3 invDir = safeInverse(dir);
+
+    float tEnter, tExit;
+    clipToBox(origin, invDir, boxMin, boxMax, tMax, tEnter, tExit);
+
+    pos = origin;
+    hitLevel = 0;
+    float t = tEnter + 1e-4;
+    int level = PYRAMID_LEVELS;
+    for (int i = 0; i < MaxDDASteps && t < tExit; i++) {
+        pos = origin + t*dir;
+        ivec3 cell = clamp(ivec3(floor(pos)), ivec3(boxMin), ivec3(boxMax) - 1);
+        ivec3 levelCell = cell >> level;
+
+        if (occupied(level, levelCell)) {
+            if (level > lodLevel(t, footprint)) {
+                level--;
+                continue;
+            }
+
+            if (level == 0 || lodMaterial(level, levelCell) != 0u) {
+                hitLevel = level;
+                return true;
+            }
+
+            // Mostly empty at this resolution, so it is skipped like empty space.
+        }
+
+        // Skip the whole empty cell at this level, then try a coarser level for the next step.
+        vec3 cellMin = vec3(levelCell << level);
+        vec3 cellMax = cellMin + float(1 << level);
+        t = max(exitBox(origin, dir, invDir, cellMin, cellMax), t) + 1e-4;
+        level = min(level + 1, PYRAMID_LEVELS);
+    }
+
+    return false;
+}
+
+bool marchHierarchicalLod(vec3 origin, vec3 dir, float tMax, float footprint, out vec3 pos, out int hitLevel) {
+    return marchRegion(origin, dir, tMax, footprint, vec3(0.0), vec3(WIDTH, HEIGHT, DEPTH), pos, hitLevel);
+}
+
+bool marchHierarchicalDDA(vec3 origin, vec3 dir, float tMax, out vec3 pos) {
+    int hitLevel;
+    return marchHierarchicalLod(origin, dir, tMax, 0.0, pos, hitLevel);
+}
+
+bool traceRay(int marchMode, vec3 origin, vec3 dir, float tMax, out vec3 pos) {
+    if (marchMode == MarchSphereTrace) {
+        return marchSphereTrace(origin, dir, tMax, pos);
+    } else if (marchMode == MarchHierarchicalDDA || marchMode == MarchBrickCooperative) {
+        // Kernels without the cooperative path walk the same pyramid per lane.
+        return marchHierarchicalDDA(origin, dir, tMax, pos);
+    }
+
+    return marchFixedStep(origin, dir, tMax, pos);
+}
+
+uint hitFace(vec3 pos, vec3 dir, ivec3 cell) {
+    // The entered face is the one the ray crossed most recently.
+    vec3 entry = mix(vec3(cell) + 1.0, vec3(cell), greaterThan(dir, vec3(0.0)));
+    vec3 back = abs(pos - entry) * abs(safeInverse(dir));
+    uint axis = back.x < back.y ? (back.x < back.z ? 0u : 2u) : (back.y < back.z ? 1u : 2u);
+    return axis * 2u + (dir[axis] > 0.0 ? 1u : 0u);
+}
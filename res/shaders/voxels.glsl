@@ -0,0 +1,48 @@
+#if defined(VOXEL_LAYOUT_IMAGE)
+layout (set = 0, binding = VOXEL_BINDING, r32i) uniform readonly iimage3D voxelImage;
+
+int voxelAt(ivec3 pos) {
+    return imageLoad(voxelImage, pos).x;
+}
+#else
+#if defined(VOXEL_BUFFER_ADDRESS)
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+// Read through a raw device address; the including shader defines VOXEL_ADDRESS as a uvec2 expression.
+layout (buffer_reference, std430, buffer_reference_align = 4) readonly buffer VoxelData {
+    int values[];
+};
+
+#define VOXEL_LOAD(index) VoxelData(VOXEL_ADDRESS).values[index]
+#else
+layout (set = 0, binding = VOXEL_BINDING, std430) readonly buffer VoxelData {
+    int voxels[];
+};
+
+#define VOXEL_LOAD(index) voxels[index]
+#endif
+
+#if defined(VOXEL_LAYOUT_MORTON)
+uint spreadBits(uint v) {
+    v &= 0x3FFu;
+    v = (v | (v << 16)) & 0x030000FFu;
+    v = (v | (v << 8)) & 0x0300F00Fu;
+    v = (v | (v << 4)) & 0x030C30C3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+uint voxelIndex(ivec3 pos) {
+    return spreadBits(uint(pos.x)) | (spreadBits(uint(pos.y)) << 1) | (spreadBits(uint(pos.z)) << 2);
+}
+#else
+uint voxelIndex(ivec3 pos) {
+    return positionToIndex(uvec3(pos));
+}
+#endif
+
+int voxelAt(ivec3 pos) {
+    return VOXEL_LOAD(voxelIndex(pos));
+}
+#endif
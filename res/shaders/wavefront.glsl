@@ -0,0 +1,78 @@
+// Resources shared by every wavefront kernel. Queue headers double as VkDispatchIndirectCommand
+// for WavefrontGroupSize-wide kernels once dispatchargs.comp has turned their counts into group counts.
+#include "dispatch.glsl"
+
+// Chosen from the device's workgroup limits; see GetWavefrontGroupSize.
+#ifndef WAVEFRONT_GROUP_SIZE
+#define WAVEFRONT_GROUP_SIZE 256
+#endif
+
+const uint WavefrontGroupSize = WAVEFRONT_GROUP_SIZE;
+
+struct Ray {
+    vec4 origin;
+    vec4 direction;
+    vec4 throughput;
+    uvec4 pixel;
+};
+
+struct Hit {
+    float t;
+    uint faceMaterial;
+};
+
+struct QueueHeader {
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint count;
+};
+
+layout (set = 0, binding = 0, std430) buffer QueueHeaders {
+    QueueHeader headers[2];
+};
+
+layout (set = 0, binding = 1, std430) buffer RayData {
+    Ray rays[];
+};
+
+layout (set = 0, binding = 2, std430) buffer HitData {
+    Hit hits[];
+};
+
+layout (set = 0, binding = 3, std430) buffer PrefixData {
+    uint prefix[];
+};
+
+layout (set = 0, binding = 4, std430) buffer BlockSumData {
+    uint blockSums[];
+};
+
+layout (set = 0, binding = 5, rgba32f) uniform image2D radianceImage;
+
+layout (push_constant) uniform constants {
+    uint frameIndex;
+    uint readQueue;
+    uint bounce;
+    uint maxBounces;
+    uint capacity;
+    int marchMode;
+    uint palette;
+    uvec2 voxelAddress;
+} PushConstants;
+
+uint readBase() {
+    return PushConstants.readQueue * PushConstants.capacity;
+}
+
+uint writeBase() {
+    return (1u - PushConstants.readQueue) * PushConstants.capacity;
+}
+
+uint liveRayCount() {
+    return headers[PushConstants.readQueue].count;
+}
+
+ivec2 unpackPixel(uint pixel) {
+    return ivec2(pixel & 0xFFFFu, pixel >> 16);
+}
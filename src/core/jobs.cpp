@@ -0,0 +1,111 @@
+#include "jobs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct JobSystem {
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsDone;
+    uint32_t pending;
+    bool running;
+};
+
+static JobSystem jobs;
+
+static void FinishJob() {
+    std::lock_guard<std::mutex> lock(jobs.mutex);
+    if (--jobs.pending == 0) {
+        jobs.jobsDone.notify_all();
+    }
+}
+
+static void WorkerLoop(uint32_t threadIndex) {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs.mutex);
+            jobs.jobAvailable.wait(lock, [] { return !jobs.running || !jobs.queue.empty(); });
+            if (!jobs.running && jobs.queue.empty()) {
+                return;
+            }
+
+            job = std::move(jobs.queue.front());
+            jobs.queue.pop_front();
+        }
+
+        job(threadIndex);
+        FinishJob();
+    }
+}
+
+void InitializeJobSystem(uint32_t workerCount) {
+    jobs.running = true;
+    jobs.pending = 0;
+
+    for (uint32_t i = 0; i < workerCount; i++) {
+        jobs.workers.emplace_back(WorkerLoop, i + 1);
+    }
+}
+
+void ShutdownJobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        jobs.running = false;
+    }
+    jobs.jobAvailable.notify_all();
+
+    for (auto &worker : jobs.workers) {
+        worker.join();
+    }
+    jobs.workers.clear();
+}
+
+uint32_t GetJobThreadCount() {
+    return (uint32_t)jobs.workers.size() + 1;
+}
+
+void ScheduleJob(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        jobs.queue.push_back(std::move(job));
+        jobs.pending++;
+    }
+    jobs.jobAvailable.notify_one();
+}
+
+// The waiting thread drains the queue itself as thread 0 before blocking on stragglers.
+void WaitForJobs() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobs.mutex);
+            if (jobs.queue.empty()) {
+                jobs.jobsDone.wait(lock, [] { return jobs.pending == 0; });
+                return;
+            }
+
+            job = std::move(jobs.queue.front());
+            jobs.queue.pop_front();
+        }
+
+        job(0);
+        FinishJob();
+    }
+}
+
+void ParallelFor(uint32_t count, uint32_t batchSize, const RangeJob &job) {
+    for (uint32_t begin = 0; begin < count; begin += batchSize) {
+        uint32_t end = begin + batchSize < count ? begin + batchSize : count;
+        ScheduleJob([&job, begin, end](uint32_t threadIndex) {
+            job(begin, end, threadIndex);
+        });
+    }
+
+    WaitForJobs();
+}
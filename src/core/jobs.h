@@ -0,0 +1,22 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <cstdint>
+#include <functional>
+
+// Jobs receive the index of the thread running them: 0 is the thread that calls WaitForJobs,
+// workers are 1..GetJobThreadCount()-1. Per-thread resources can be indexed with it.
+using Job = std::function<void(uint32_t threadIndex)>;
+using RangeJob = std::function<void(uint32_t begin, uint32_t end, uint32_t threadIndex)>;
+
+void InitializeJobSystem(uint32_t workerCount);
+void ShutdownJobSystem();
+
+uint32_t GetJobThreadCount();
+void ScheduleJob(Job job);
+void WaitForJobs();
+
+// Splits [0, count) into batches of batchSize, runs them as jobs and waits for all of them.
+void ParallelFor(uint32_t count, uint32_t batchSize, const RangeJob &job);
+
+#endif // JOBS_H
@@ -1,32 +1,141 @@
 #include <cstdio>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
 #include <SDL2/SDL.h>
 #include <Volk/volk.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include "core/jobs.h"
 #include "rendering/context.h"
+#include "world/world.h"
 
-const int WIDTH = 64;
-const int HEIGHT = 64;
-const int DEPTH = 64;
+const int WIDTH = VoxelGridWidth;
+const int HEIGHT = VoxelGridHeight;
+const int DEPTH = VoxelGridDepth;
 
 int positionToIndex(const glm::uvec3 &pos) {
     return pos.x + pos.y * WIDTH + pos.z * WIDTH * HEIGHT;
 }
 
+uint32_t ParseInstanceCount(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--instances=", 12) == 0) {
+            return (uint32_t)glm::max(atoi(argv[i] + 12), 0);
+        }
+    }
+
+    return 0;
+}
+
+RenderSettings ParseSettings(int argc, char **argv) {
+    RenderSettings settings = {};
+    settings.voxelLayout = VoxelLayoutMorton;
+    settings.renderMode = RenderModeAuto;
+    settings.marchMode = MarchSphereTrace;
+    settings.lodScale = 1.0f;
+    settings.animateCamera = true;
+    settings.needsRayMarch = ParseInstanceCount(argc, argv) > 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--voxel-layout=linear") == 0) {
+            settings.voxelLayout = VoxelLayoutLinear;
+        } else if (strcmp(argv[i], "--voxel-layout=morton") == 0) {
+            settings.voxelLayout = VoxelLayoutMorton;
+        } else if (strcmp(argv[i], "--voxel-layout=image") == 0) {
+            settings.voxelLayout = VoxelLayoutImage;
+        } else if (strcmp(argv[i], "--march=fixed") == 0) {
+            settings.marchMode = MarchFixedStep;
+            settings.needsRayMarch = true;
+        } else if (strcmp(argv[i], "--march=sphere") == 0) {
+            settings.marchMode = MarchSphereTrace;
+            settings.needsRayMarch = true;
+        } else if (strcmp(argv[i], "--march=dda") == 0) {
+            settings.marchMode = MarchHierarchicalDDA;
+            settings.needsRayMarch = true;
+        } else if (strcmp(argv[i], "--march=brick") == 0) {
+            settings.marchMode = MarchBrickCooperative;
+            settings.needsRayMarch = true;
+        } else if (strncmp(argv[i], "--lod=", 6) == 0) {
+            settings.lodScale = glm::max((float)atof(argv[i] + 6), 0.0f);
+            settings.needsRayMarch = true;
+        } else if (strcmp(argv[i], "--static-camera") == 0) {
+            settings.animateCamera = false;
+        } else if (strcmp(argv[i], "--low-latency") == 0) {
+            settings.lowLatency = true;
+        } else if (strncmp(argv[i], "--device=", 9) == 0) {
+            settings.device = argv[i] + 9;
+        } else if (strcmp(argv[i], "--multi-gpu") == 0) {
+            settings.multiGpu = true;
+        } else if (strcmp(argv[i], "--wavefront") == 0) {
+            settings.renderMode = RenderModeWavefront;
+        } else if (strcmp(argv[i], "--megakernel") == 0) {
+            settings.renderMode = RenderModeMegakernel;
+        } else if (strcmp(argv[i], "--raster") == 0) {
+            settings.renderMode = RenderModeRaster;
+        } else if (strncmp(argv[i], "--bounces=", 10) == 0) {
+            settings.maxBounces = (uint32_t)glm::max(atoi(argv[i] + 10), 1);
+        } else if (strncmp(argv[i], "--ray-budget=", 13) == 0) {
+            settings.rayBudget = (uint32_t)glm::max(atoi(argv[i] + 13), 1);
+        } else if (strncmp(argv[i], "--max-rays-per-pixel=", 21) == 0) {
+            settings.maxRaysPerPixel = (uint32_t)glm::max(atoi(argv[i] + 21), 1);
+        }
+    }
+
+    return settings;
+}
+
+// Lays copies of the whole grid out on a square over the grid's footprint, each turned about its own centre.
+void CreateInstanceGrid(uint32_t count) {
+    ModelHandle model = CreateVoxelModel(glm::ivec3(0), glm::ivec3(WIDTH, HEIGHT, DEPTH));
+
+    uint32_t side = (uint32_t)glm::ceil(glm::sqrt((float)count));
+    float cell = (float)WIDTH / (float)side;
+    float scale = 0.8f * cell / (float)WIDTH;
+    glm::vec3 pivot = glm::vec3(WIDTH, HEIGHT, DEPTH) * 0.5f;
+
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 center((i % side + 0.5f) * cell, (float)HEIGHT * 0.5f, (i / side + 0.5f) * cell);
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), center);
+        transform = glm::rotate(transform, (float)i * 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(scale));
+        transform = glm::translate(transform, -pivot);
+        CreateInstance(model, transform);
+    }
+}
+
+// Window coordinates differ from renderImage pixels on high-DPI displays.
+glm::ivec2 WindowToRenderPixel(SDL_Window *window, int x, int y) {
+    int windowWidth = 0, windowHeight = 0;
+    SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+    glm::vec2 scale = glm::vec2(context.renderImage.width, context.renderImage.height) / glm::max(glm::vec2(windowWidth, windowHeight), glm::vec2(1.0f));
+
+    return glm::ivec2(glm::vec2(x, y) * scale);
+}
+
 int main(int argc, char **argv) {
     SDL_Init(SDL_INIT_EVERYTHING);
 
-    SDL_Window *window = SDL_CreateWindow("Voxel", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_VULKAN);
+    SDL_Window *window = SDL_CreateWindow("Voxel", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
     if (!window) {
         printf("Failed to create SDL window: %s", SDL_GetError());
         return 1;
     }
 
-    Result r = InitializeRenderContext(window);
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    InitializeJobSystem(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+
+    Result r = InitializeRenderContext(window, ParseSettings(argc, argv));
     if (r != Success) {
         printf("Failed to initialize rendering: %d\n", r);
+        // Workers left joinable would terminate the process when the job system's statics are destroyed.
+        ShutdownJobSystem();
+        SDL_DestroyWindow(window);
+        SDL_Quit();
         return 1;
     }
 
@@ -42,7 +151,7 @@ int main(int argc, char **argv) {
                 int newy = (y - center.y)*(y - center.y);
                 int newz = (z - center.z)*(z - center.z);
                 if (newx + newy + newz < WIDTH*WIDTH/16) {
-                    voxels[index] = 1;
+                    voxels[index] = y > center.y ? 2 : 1;
                 } else {
                     voxels[index] = 0;
                 }
@@ -50,7 +159,33 @@ int main(int argc, char **argv) {
         }
     }
 
-    UploadVoxelData(voxels);
+    r = UploadMaterialPalette({
+        CreateMaterial(glm::vec3(0.0f), 1.0f),
+        CreateMaterial(glm::vec3(0.55f, 0.5f, 0.45f), 0.9f),
+        CreateMaterial(glm::vec3(0.3f, 0.65f, 0.25f), 0.6f),
+    });
+    if (r == Success) {
+        r = UploadVoxelData(voxels);
+    }
+    if (r != Success) {
+        printf("Failed to upload scene data: %d\n", r);
+        ShutdownRenderContext();
+        ShutdownJobSystem();
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    uint32_t instanceCount = ParseInstanceCount(argc, argv);
+    if (instanceCount > 0) {
+        CreateInstanceGrid(instanceCount);
+    }
+
+    if (context.settings.animateCamera) {
+        SetCameraSource([]() { return GetOrbitCamera((float)SDL_GetTicks()); });
+    }
+
+    PickTicket pickTicket = InvalidPickTicket;
 
     bool running = true;
     while (running) {
@@ -58,12 +193,42 @@ int main(int argc, char **argv) {
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_QUIT) {
                 running = false;
+            } else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                context.swapchainDirty = true;
+            } else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
+                RayHit hit = PickVoxel(WindowToRenderPixel(window, e.button.x, e.button.y));
+                if (hit.hit) {
+                    printf("Picked voxel (%d, %d, %d), material %d\n", hit.voxel.x, hit.voxel.y, hit.voxel.z, hit.material);
+                }
+            } else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_RIGHT) {
+                CancelPick(pickTicket);
+                pickTicket = RequestPick(WindowToRenderPixel(window, e.button.x, e.button.y));
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3) {
+                PrintMemoryStats();
+                DumpMemoryStats("memory_stats.json");
             }
         }
 
+        if (SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED) {
+            SDL_Delay(10);
+            continue;
+        }
+
         RenderFrame();
+
+        PickResult pick = {};
+        if (pickTicket != InvalidPickTicket && GetPickResult(pickTicket, &pick)) {
+            pickTicket = InvalidPickTicket;
+            if (pick.hit) {
+                printf("GPU picked voxel (%d, %d, %d), material %u, instance %d\n", pick.voxel.x, pick.voxel.y, pick.voxel.z, pick.material,
+                    pick.instance == NoInstance ? -1 : (int)pick.instance);
+            }
+        }
     }
 
+    ShutdownRenderContext();
+    ShutdownJobSystem();
+
     SDL_DestroyWindow(window);
     SDL_Quit();
 
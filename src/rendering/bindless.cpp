@@ -0,0 +1,157 @@
+#include "bindless.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+// Both take the heap's frame rather than context.frameCount, which job threads can't read safely.
+static BindlessHandle AllocateHandle(HandleAllocator *allocator, uint32_t frame) {
+    for (size_t i = 0; i < allocator->retired.size(); i++) {
+        if (allocator->retired[i].reusableFrame <= frame) {
+            BindlessHandle handle = allocator->retired[i].handle;
+            allocator->retired[i] = allocator->retired.back();
+            allocator->retired.pop_back();
+            return handle;
+        }
+    }
+
+    if (allocator->next == allocator->capacity) {
+        return InvalidBindlessHandle;
+    }
+
+    return allocator->next++;
+}
+
+static void ReleaseHandle(HandleAllocator *allocator, BindlessHandle handle, uint32_t frame) {
+    if (handle != InvalidBindlessHandle) {
+        allocator->retired.push_back({handle, frame + MaxFramesInFlight});
+    }
+}
+
+Result CreateBindlessHeap(BindlessHeap *heap) {
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        { BindlessBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MaxBindlessBuffers, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+        { BindlessStorageImageBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MaxBindlessStorageImages, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+        { BindlessTextureBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxBindlessTextures, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+    };
+
+    std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size(), VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT);
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo = {};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.pNext = nullptr;
+    flagsInfo.bindingCount = (uint32_t)bindingFlags.size();
+    flagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = GetDescriptorsetLayoutCreatInfo(bindings);
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    VkCheck(vkCreateDescriptorSetLayout(context.device, &layoutInfo, nullptr, &heap->layout));
+
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MaxBindlessBuffers },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MaxBindlessStorageImages },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxBindlessTextures },
+    };
+    VkDescriptorPoolCreateInfo poolInfo = GetDescriptorPoolCreateInfo(1, poolSizes);
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    VkCheck(vkCreateDescriptorPool(context.device, &poolInfo, nullptr, &heap->pool));
+
+    std::vector<VkDescriptorSetLayout> layouts = {heap->layout};
+    VkDescriptorSetAllocateInfo setAllocInfo = GetDescriptorSetAllocateInfo(heap->pool, layouts);
+    VkCheck(vkAllocateDescriptorSets(context.device, &setAllocInfo, &heap->set));
+
+    heap->buffers = {{}, 0, MaxBindlessBuffers};
+    heap->storageImages = {{}, 0, MaxBindlessStorageImages};
+    heap->textures = {{}, 0, MaxBindlessTextures};
+    heap->frame = 0;
+
+    return Success;
+}
+
+BindlessHandle RegisterBindlessBuffer(const Buffer &buffer) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+
+    BindlessHandle handle = AllocateHandle(&context.bindless.buffers, context.bindless.frame);
+    if (handle == InvalidBindlessHandle) {
+        return handle;
+    }
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = buffer.buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(context.bindless.set, BindlessBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, nullptr);
+    write.dstArrayElement = handle;
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+
+    return handle;
+}
+
+BindlessHandle RegisterBindlessStorageImage(const Image &image) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+
+    BindlessHandle handle = AllocateHandle(&context.bindless.storageImages, context.bindless.frame);
+    if (handle == InvalidBindlessHandle) {
+        return handle;
+    }
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfo.imageView = image.view;
+    imageInfo.sampler = VK_NULL_HANDLE;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(context.bindless.set, BindlessStorageImageBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, nullptr, &imageInfo);
+    write.dstArrayElement = handle;
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+
+    return handle;
+}
+
+BindlessHandle RegisterBindlessTexture(const Image &image, VkSampler sampler) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+
+    BindlessHandle handle = AllocateHandle(&context.bindless.textures, context.bindless.frame);
+    if (handle == InvalidBindlessHandle) {
+        return handle;
+    }
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfo.imageView = image.view;
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(context.bindless.set, BindlessTextureBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &imageInfo);
+    write.dstArrayElement = handle;
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+
+    return handle;
+}
+
+void ReleaseBindlessBuffer(BindlessHandle handle) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+    ReleaseHandle(&context.bindless.buffers, handle, context.bindless.frame);
+}
+
+void ReleaseBindlessStorageImage(BindlessHandle handle) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+    ReleaseHandle(&context.bindless.storageImages, handle, context.bindless.frame);
+}
+
+void ReleaseBindlessTexture(BindlessHandle handle) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+    ReleaseHandle(&context.bindless.textures, handle, context.bindless.frame);
+}
+
+void UpdateBindlessFrame(uint32_t frameIndex) {
+    std::lock_guard<std::mutex> lock(context.bindless.mutex);
+    context.bindless.frame = frameIndex;
+}
+
+void DestroyBindlessHeap(BindlessHeap *heap) {
+    vkDestroyDescriptorPool(context.device, heap->pool, nullptr);
+    vkDestroyDescriptorSetLayout(context.device, heap->layout, nullptr);
+    heap->pool = VK_NULL_HANDLE;
+    heap->layout = VK_NULL_HANDLE;
+    heap->set = VK_NULL_HANDLE;
+}
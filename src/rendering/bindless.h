@@ -0,0 +1,67 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#include <Volk/volk.h>
+
+#include <mutex>
+#include <vector>
+
+#include "buffer.h"
+#include "image.h"
+
+// The heap is bound at set 1 of every pipeline whose shaders declare set 1 resources.
+constexpr uint32_t BindlessSet = 1;
+constexpr uint32_t BindlessBufferBinding = 0;
+constexpr uint32_t BindlessStorageImageBinding = 1;
+constexpr uint32_t BindlessTextureBinding = 2;
+
+constexpr uint32_t MaxBindlessBuffers = 4096;
+constexpr uint32_t MaxBindlessStorageImages = 1024;
+constexpr uint32_t MaxBindlessTextures = 1024;
+
+using BindlessHandle = uint32_t;
+constexpr BindlessHandle InvalidBindlessHandle = UINT32_MAX;
+
+// Released handles are only reused once every frame that might still index them has retired.
+struct HandleAllocator {
+    struct RetiredHandle {
+        BindlessHandle handle;
+        uint32_t reusableFrame;
+    };
+
+    std::vector<RetiredHandle> retired;
+    uint32_t next;
+    uint32_t capacity;
+};
+
+struct BindlessHeap {
+    VkDescriptorPool pool;
+    VkDescriptorSetLayout layout;
+    VkDescriptorSet set;
+
+    HandleAllocator buffers;
+    HandleAllocator storageImages;
+    HandleAllocator textures;
+
+    // Copy of the frame counter for threads that register or release off the render thread; read and
+    // written under mutex.
+    uint32_t frame;
+    std::mutex mutex;
+};
+
+enum Result : int;
+
+Result CreateBindlessHeap(BindlessHeap *heap);
+void DestroyBindlessHeap(BindlessHeap *heap);
+// Call from the render thread whenever context.frameCount advances.
+void UpdateBindlessFrame(uint32_t frameIndex);
+
+BindlessHandle RegisterBindlessBuffer(const Buffer &buffer);
+BindlessHandle RegisterBindlessStorageImage(const Image &image);
+BindlessHandle RegisterBindlessTexture(const Image &image, VkSampler sampler);
+
+void ReleaseBindlessBuffer(BindlessHandle handle);
+void ReleaseBindlessStorageImage(BindlessHandle handle);
+void ReleaseBindlessTexture(BindlessHandle handle);
+
+#endif // BINDLESS_H
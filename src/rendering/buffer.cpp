@@ -3,7 +3,7 @@
 #include "context.h"
 #include "vkutil.h"
 
-Buffer CreateBuffer(uint32_t size, VkBufferUsageFlags usage, VmaMemoryUsage memUsage) {
+Buffer CreateBuffer(uint32_t size, VkBufferUsageFlags usage, VmaMemoryUsage memUsage, MemoryCategory category) {
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.pNext = nullptr;
@@ -16,17 +16,58 @@ Buffer CreateBuffer(uint32_t size, VkBufferUsageFlags usage, VmaMemoryUsage memU
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = memUsage;
+    allocInfo.pool = GetBufferPool(category);
 
     Buffer buffer = {};
     buffer.size = size;
-    vmaCreateBuffer(context.allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.alloc, nullptr);
+    VkResult res = vmaCreateBuffer(context.allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.alloc, nullptr);
+    if (res != VK_SUCCESS && allocInfo.pool != VK_NULL_HANDLE) {
+        // The pool's memory type may not suit this usage; fall back to the default heaps.
+        allocInfo.pool = VK_NULL_HANDLE;
+        res = vmaCreateBuffer(context.allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.alloc, nullptr);
+    }
+    if (res != VK_SUCCESS) {
+        printf("Failed to allocate %u byte %s buffer: %s\n", size, GetMemoryCategoryName(category), string_VkResult(res));
+        return {};
+    }
+    TrackAllocation(buffer.alloc, category);
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+        VkBufferDeviceAddressInfo addressInfo = {};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        addressInfo.pNext = nullptr;
+        addressInfo.buffer = buffer.buffer;
+        buffer.address = vkGetBufferDeviceAddress(context.device, &addressInfo);
+    }
 
     return buffer;
 }
 
-void CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount) {
-    Buffer staging = CreateBuffer(dataCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    
+void DestroyBuffer(Buffer *buffer) {
+    if (buffer->buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    UntrackAllocation(buffer->alloc);
+    vmaDestroyBuffer(context.allocator, buffer->buffer, buffer->alloc);
+    *buffer = {};
+}
+
+Result CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount) {
+    VkBufferCopy copy = {};
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = dataCount;
+
+    return CopyToBuffer(buffer, data, dataCount, {copy});
+}
+
+Result CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount, const std::vector<VkBufferCopy> &regions) {
+    Buffer staging = CreateBuffer(dataCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategoryStaging);
+    if (staging.buffer == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+
     uint8_t *stagingData;
     vmaMapMemory(context.allocator, staging.alloc, (void **)&stagingData);
     std::memcpy(stagingData, data, dataCount);
@@ -34,12 +75,44 @@ void CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount) {
     vmaFlushAllocation(context.allocator, staging.alloc, 0, VK_WHOLE_SIZE);
 
     VkCommandBuffer cmd = BeginSingleUseCmd();
-    VkBufferCopy copy = {};
-    copy.srcOffset = 0;
-    copy.dstOffset = 0;
-    copy.size = dataCount;
+    vkCmdCopyBuffer(cmd, staging.buffer, buffer->buffer, (uint32_t)regions.size(), regions.data());
+    ReleaseAfterSubmit(staging);
+    EndSingleUseCmd(cmd);
 
-    vkCmdCopyBuffer(cmd, staging.buffer, buffer->buffer, 1, &copy);
+    return Success;
+}
 
-    EndSingleUseCmd(cmd);
+void BindStorageBuffer(VkDescriptorSet set, uint32_t binding, const Buffer &buffer) {
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = buffer.buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, nullptr);
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+}
+
+void BindDynamicUniformBuffer(VkDescriptorSet set, uint32_t binding, const Buffer &buffer, uint32_t range) {
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = buffer.buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &bufferInfo, nullptr);
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+}
+
+void BufferBarrier(VkCommandBuffer cmd, const Buffer &buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer.buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 }
\ No newline at end of file
@@ -4,13 +4,31 @@
 #include <Volk/volk.h>
 #include <vma/vk_mem_alloc.h>
 
+#include <vector>
+
+#include "memory.h"
+
 struct Buffer {
     VkBuffer buffer;
     VmaAllocation alloc;
     uint32_t size;
+
+    // Non-zero only for buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+    VkDeviceAddress address;
 };
 
-Buffer CreateBuffer(uint32_t size, VkBufferUsageFlags usage, VmaMemoryUsage memUsage);
-void CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount);
+// Returns an empty buffer when the allocation fails.
+Buffer CreateBuffer(uint32_t size, VkBufferUsageFlags usage, VmaMemoryUsage memUsage, MemoryCategory category = MemoryCategoryGeneral);
+void DestroyBuffer(Buffer *buffer);
+
+enum Result : int;
+
+// Nothing is recorded when the staging allocation fails, so the destination is left untouched.
+Result CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount);
+Result CopyToBuffer(Buffer *buffer, uint8_t *data, uint32_t dataCount, const std::vector<VkBufferCopy> &regions);
+
+void BindStorageBuffer(VkDescriptorSet set, uint32_t binding, const Buffer &buffer);
+void BindDynamicUniformBuffer(VkDescriptorSet set, uint32_t binding, const Buffer &buffer, uint32_t range);
+void BufferBarrier(VkCommandBuffer cmd, const Buffer &buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
 
 #endif // BUFFER_H
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+
+#include "context.h"
+#include "vkutil.h"
+
+constexpr float CameraNearPlane = 0.1f;
+constexpr float CameraFarPlane = 1000.0f;
+
+Camera GetOrbitCamera(float time) {
+    glm::vec3 target = glm::vec3(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth) / 2.0f;
+    float dist = 35.0f;
+    float slowedTime = time * 0.001f;
+
+    Camera camera = {};
+    camera.position = target + glm::vec3(dist * glm::sin(slowedTime), 0.0f, dist * glm::cos(slowedTime));
+    camera.target = target;
+    camera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+    camera.fovY = glm::radians(60.0f);
+    return camera;
+}
+
+CameraConstants GetCameraConstants(const Camera &camera, uint32_t width, uint32_t height) {
+    float aspectRatio = (float)width / (float)height;
+
+    glm::vec3 forward = glm::normalize(camera.target - camera.position);
+    glm::vec3 right = glm::normalize(glm::cross(forward, camera.up));
+    glm::vec3 up = glm::cross(right, forward);
+
+    float viewportHeight = 2.0f * glm::tan(camera.fovY / 2.0f);
+    float viewportWidth = viewportHeight * aspectRatio;
+
+    glm::vec3 rayDx = right * (viewportWidth / (float)width);
+    glm::vec3 rayDy = up * (viewportHeight / (float)height);
+    glm::vec3 rayCorner = forward - 0.5f * viewportWidth * right - 0.5f * viewportHeight * up + 0.5f * (rayDx + rayDy);
+
+    CameraConstants constants = {};
+    constants.view = glm::lookAt(camera.position, camera.target, camera.up);
+    constants.projection = glm::perspective(camera.fovY, aspectRatio, CameraNearPlane, CameraFarPlane);
+    constants.viewProjection = constants.projection * constants.view;
+    constants.origin = glm::vec4(camera.position, 1.0f);
+    constants.rayCorner = glm::vec4(rayCorner, 0.0f);
+    constants.rayDx = glm::vec4(rayDx, 0.0f);
+    constants.rayDy = glm::vec4(rayDy, 0.0f);
+    return constants;
+}
+
+void SetCamera(const Camera &camera) {
+    context.camera = camera;
+}
+
+void SetCameraSource(CameraSource source) {
+    context.cameraSource = source;
+}
+
+Result CreateFrameConstantsRing(FrameConstantsRing *ring) {
+    uint32_t alignment = (uint32_t)context.deviceProperties.limits.minUniformBufferOffsetAlignment;
+    ring->stride = (sizeof(FrameConstants) + alignment - 1) / alignment * alignment;
+    ring->buffer = CreateBuffer(ring->stride * MaxFramesInFlight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+    VkCheck(vmaMapMemory(context.allocator, ring->buffer.alloc, (void **)&ring->mapped));
+
+    return Success;
+}
+
+void DestroyFrameConstantsRing(FrameConstantsRing *ring) {
+    vmaUnmapMemory(context.allocator, ring->buffer.alloc);
+    DestroyBuffer(&ring->buffer);
+    ring->mapped = nullptr;
+}
+
+void WriteFrameConstants(FrameConstantsRing *ring, uint32_t slot, const FrameConstants &constants) {
+    std::memcpy(ring->mapped + ring->stride * slot, &constants, sizeof(constants));
+    vmaFlushAllocation(context.allocator, ring->buffer.alloc, ring->stride * slot, sizeof(constants));
+}
+
+void BindFrameConstants(VkDescriptorSet set, uint32_t binding, const FrameConstantsRing &ring) {
+    BindDynamicUniformBuffer(set, binding, ring.buffer, sizeof(FrameConstants));
+}
@@ -0,0 +1,67 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+
+#include "buffer.h"
+#include "pipeline.h"
+
+struct Camera {
+    glm::vec3 position;
+    glm::vec3 target;
+    glm::vec3 up;
+    float fovY;
+};
+
+// std140 mirror of CameraData in camera.glsl. The unnormalised direction through pixel (x, y)
+// is rayCorner + x * rayDx + y * rayDy.
+struct CameraConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 origin;
+    glm::vec4 rayCorner;
+    glm::vec4 rayDx;
+    glm::vec4 rayDy;
+};
+
+struct FrameConstants {
+    CameraConstants camera;
+    CameraConstants prevCamera;
+    glm::ivec2 screenSize;
+    uint32_t frameIndex;
+
+    // Bindless handles of the scene BVH, only valid when instanceCount is non-zero.
+    uint32_t instanceCount;
+    uint32_t sceneNodes;
+    uint32_t sceneInstances;
+    uint32_t padding[2];
+};
+
+// One FrameConstants slot per frame in flight, persistently mapped.
+struct FrameConstantsRing {
+    Buffer buffer;
+    uint8_t *mapped;
+    uint32_t stride;
+};
+
+// Polled by RenderFrame once the frame's fences and swapchain image are acquired, so the camera is
+// latched as late as possible before recording.
+using CameraSource = std::function<Camera()>;
+
+enum Result : int;
+
+Camera GetOrbitCamera(float time);
+CameraConstants GetCameraConstants(const Camera &camera, uint32_t width, uint32_t height);
+void SetCamera(const Camera &camera);
+void SetCameraSource(CameraSource source);
+
+Result CreateFrameConstantsRing(FrameConstantsRing *ring);
+void DestroyFrameConstantsRing(FrameConstantsRing *ring);
+void WriteFrameConstants(FrameConstantsRing *ring, uint32_t slot, const FrameConstants &constants);
+void BindFrameConstants(VkDescriptorSet set, uint32_t binding, const FrameConstantsRing &ring);
+
+#endif // CAMERA_H
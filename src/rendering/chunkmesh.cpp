@@ -0,0 +1,93 @@
+#include "chunkmesh.h"
+
+#include <algorithm>
+#include <array>
+
+static int GetVoxel(const std::vector<int> &data, glm::ivec3 gridSize, glm::ivec3 pos) {
+    if (glm::any(glm::lessThan(pos, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(pos, gridSize))) {
+        return 0;
+    }
+
+    return data[pos.x + pos.y * gridSize.x + pos.z * gridSize.x * gridSize.y];
+}
+
+static uint32_t PackVertex(glm::ivec3 corner, uint32_t face, uint32_t material) {
+    return (uint32_t)corner.x | ((uint32_t)corner.y << MeshPositionBits) | ((uint32_t)corner.z << (2 * MeshPositionBits))
+        | (face << MeshFaceShift) | (material << MeshMaterialShift);
+}
+
+// Sweeps each face direction a slice at a time. The faces a slice shows go into a mask, which is then
+// covered with rectangles of one material: grown along u first, then along v while whole rows match.
+void MeshChunk(const std::vector<int> &data, glm::ivec3 gridSize, glm::ivec3 origin, std::vector<uint32_t> &vertices) {
+    std::array<int, ChunkSize * ChunkSize> mask;
+
+    for (uint32_t face = 0; face < 6; face++) {
+        int axis = face >> 1;
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        bool negative = (face & 1) != 0;
+
+        glm::ivec3 normal(0);
+        normal[axis] = negative ? -1 : 1;
+
+        for (int slice = 0; slice < ChunkSize; slice++) {
+            for (int j = 0; j < ChunkSize; j++) {
+                for (int i = 0; i < ChunkSize; i++) {
+                    glm::ivec3 pos = origin;
+                    pos[axis] += slice;
+                    pos[u] += i;
+                    pos[v] += j;
+
+                    int voxel = GetVoxel(data, gridSize, pos);
+                    mask[i + j * ChunkSize] = (voxel != 0 && GetVoxel(data, gridSize, pos + normal) == 0) ? voxel : 0;
+                }
+            }
+
+            for (int j = 0; j < ChunkSize; j++) {
+                for (int i = 0; i < ChunkSize;) {
+                    int material = mask[i + j * ChunkSize];
+                    if (material == 0) {
+                        i++;
+                        continue;
+                    }
+
+                    int width = 1;
+                    while (i + width < ChunkSize && mask[i + width + j * ChunkSize] == material) {
+                        width++;
+                    }
+
+                    int height = 1;
+                    for (; j + height < ChunkSize; height++) {
+                        int *row = &mask[i + (j + height) * ChunkSize];
+                        if (std::any_of(row, row + width, [material](int m) { return m != material; })) {
+                            break;
+                        }
+                    }
+
+                    for (int y = j; y < j + height; y++) {
+                        std::fill_n(&mask[i + y * ChunkSize], width, 0);
+                    }
+
+                    glm::ivec3 corner(0), du(0), dv(0);
+                    corner[axis] = negative ? slice : slice + 1;
+                    corner[u] = i;
+                    corner[v] = j;
+                    du[u] = width;
+                    dv[v] = height;
+                    // Counter-clockwise seen from outside, so back faces can be culled.
+                    if (negative) {
+                        std::swap(du, dv);
+                    }
+
+                    uint32_t packedMaterial = std::min((uint32_t)material, MaxMeshMaterial);
+                    vertices.push_back(PackVertex(corner, face, packedMaterial));
+                    vertices.push_back(PackVertex(corner + du, face, packedMaterial));
+                    vertices.push_back(PackVertex(corner + du + dv, face, packedMaterial));
+                    vertices.push_back(PackVertex(corner + dv, face, packedMaterial));
+
+                    i += width;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef CHUNKMESH_H
+#define CHUNKMESH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+constexpr int32_t ChunkSize = 16;
+// Every solid voxel of a checkerboard shows all six faces; nothing can produce more quads than that.
+constexpr uint32_t MaxChunkQuads = ChunkSize * ChunkSize * ChunkSize * 3;
+
+// Vertices are one uint: chunk-local corner in bits 0..14 (5 bits per axis, corners run 0..ChunkSize),
+// face in bits 15..17 and material from bit 18. mesh.vert unpacks the same layout.
+constexpr uint32_t MeshPositionBits = 5;
+constexpr uint32_t MeshFaceShift = 15;
+constexpr uint32_t MeshMaterialShift = 18;
+constexpr uint32_t MaxMeshMaterial = (1u << (32 - MeshMaterialShift)) - 1;
+
+// Appends four vertices per quad for the visible faces of the ChunkSize cube at origin. data is the whole
+// grid of gridSize voxels; voxels outside it count as empty.
+void MeshChunk(const std::vector<int> &data, glm::ivec3 gridSize, glm::ivec3 origin, std::vector<uint32_t> &vertices);
+
+#endif // CHUNKMESH_H
@@ -0,0 +1,251 @@
+#include "commands.h"
+
+#include <cassert>
+
+#include "context.h"
+#include "vkutil.h"
+#include "../core/jobs.h"
+
+Result CreateThreadCommandPools(std::vector<ThreadCommandPool> *pools, uint32_t threadCount) {
+    pools->resize(threadCount);
+
+    for (auto &pool : *pools) {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = context.queueFamily;
+
+        VkCheck(vkCreateCommandPool(context.device, &poolInfo, nullptr, &pool.pool));
+        pool.used = 0;
+    }
+
+    return Success;
+}
+
+void DestroyThreadCommandPools(std::vector<ThreadCommandPool> *pools) {
+    for (auto &pool : *pools) {
+        vkDestroyCommandPool(context.device, pool.pool, nullptr);
+    }
+    pools->clear();
+}
+
+void ResetThreadCommandPools(std::vector<ThreadCommandPool> *pools) {
+    for (auto &pool : *pools) {
+        vkResetCommandPool(context.device, pool.pool, 0);
+        pool.used = 0;
+    }
+}
+
+VkCommandBuffer BeginSecondaryCmd(ThreadCommandPool *pool) {
+    if (pool->used == pool->buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo = GetCommandBufferAllocateInfo(pool->pool, 1);
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+        VkCommandBuffer cmd;
+        vkAllocateCommandBuffers(context.device, &allocInfo, &cmd);
+        pool->buffers.push_back(cmd);
+    }
+
+    VkCommandBuffer cmd = pool->buffers[pool->used++];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = nullptr;
+    inheritanceInfo.renderPass = VK_NULL_HANDLE;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo beginInfo = GetCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    return cmd;
+}
+
+// Each recorder fills its own secondary buffer on whichever thread picks it up; the results are
+// executed in recorder order, so barriers recorded inside them keep their meaning.
+void RecordParallel(VkCommandBuffer primary, std::vector<ThreadCommandPool> *pools, const std::vector<CommandRecorder> &recorders) {
+    std::vector<VkCommandBuffer> secondaries(recorders.size());
+
+    for (size_t i = 0; i < recorders.size(); i++) {
+        ScheduleJob([pools, &recorders, &secondaries, i](uint32_t threadIndex) {
+            VkCommandBuffer cmd = BeginSecondaryCmd(&(*pools)[threadIndex]);
+            recorders[i](cmd);
+            vkEndCommandBuffer(cmd);
+            secondaries[i] = cmd;
+        });
+    }
+
+    WaitForJobs();
+
+    if (!secondaries.empty()) {
+        vkCmdExecuteCommands(primary, (uint32_t)secondaries.size(), secondaries.data());
+    }
+}
+
+Result CreateImmediateSubmitter(ImmediateSubmitter *submitter) {
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = context.queueFamily;
+
+    VkCheck(vkCreateCommandPool(context.device, &poolInfo, nullptr, &submitter->pool));
+
+    for (auto &slot : submitter->slots) {
+        VkCommandBufferAllocateInfo allocInfo = GetCommandBufferAllocateInfo(submitter->pool, 1);
+        VkCheck(vkAllocateCommandBuffers(context.device, &allocInfo, &slot.cmd));
+
+        slot.fence = CreateFence(VK_FENCE_CREATE_SIGNALED_BIT);
+        slot.ticket = 0;
+    }
+
+    submitter->nextSlot = 0;
+    submitter->recordingSlot = -1;
+    submitter->batchDepth = 0;
+    submitter->lastTicket = 0;
+
+    return Success;
+}
+
+static void RecycleSlot(ImmediateSlot *slot) {
+    vkWaitForFences(context.device, 1, &slot->fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(context.device, 1, &slot->fence);
+
+    FlushDeletionQueue(&slot->deletionQueue);
+
+    vkResetCommandBuffer(slot->cmd, 0);
+}
+
+static SubmitTicket SubmitRecording(ImmediateSubmitter *submitter) {
+    ImmediateSlot &slot = submitter->slots[submitter->recordingSlot];
+    submitter->recordingSlot = -1;
+
+    // Make the results visible to whatever is submitted next, frames included.
+    GlobalBarrier(slot.cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+    vkEndCommandBuffer(slot.cmd);
+
+    VkSubmitInfo info = GetSubmitInfo(&slot.cmd, {}, {}, {});
+    vkQueueSubmit(context.queue, 1, &info, slot.fence);
+
+    return slot.ticket;
+}
+
+void DestroyImmediateSubmitter(ImmediateSubmitter *submitter) {
+    if (submitter->recordingSlot >= 0) {
+        SubmitRecording(submitter);
+    }
+
+    for (auto &slot : submitter->slots) {
+        vkWaitForFences(context.device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        FlushDeletionQueue(&slot.deletionQueue);
+        vkDestroyFence(context.device, slot.fence, nullptr);
+    }
+
+    vkDestroyCommandPool(context.device, submitter->pool, nullptr);
+}
+
+VkCommandBuffer BeginSingleUseCmd() {
+    ImmediateSubmitter &submitter = context.immediate;
+    if (submitter.recordingSlot >= 0) {
+        return submitter.slots[submitter.recordingSlot].cmd;
+    }
+
+    submitter.recordingSlot = (int32_t)submitter.nextSlot;
+    submitter.nextSlot = (submitter.nextSlot + 1) % ImmediateSlotCount;
+
+    ImmediateSlot &slot = submitter.slots[submitter.recordingSlot];
+    RecycleSlot(&slot);
+    slot.ticket = ++submitter.lastTicket;
+
+    VkCommandBufferBeginInfo info = GetCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkBeginCommandBuffer(slot.cmd, &info);
+
+    // Order against frames still in flight that may read what this submission overwrites.
+    GlobalBarrier(slot.cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+
+    return slot.cmd;
+}
+
+SubmitTicket EndSingleUseCmd(VkCommandBuffer cmd) {
+    ImmediateSubmitter &submitter = context.immediate;
+    if (submitter.batchDepth > 0) {
+        return submitter.slots[submitter.recordingSlot].ticket;
+    }
+
+    return SubmitRecording(&submitter);
+}
+
+void BeginImmediateBatch() {
+    context.immediate.batchDepth++;
+}
+
+SubmitTicket EndImmediateBatch() {
+    ImmediateSubmitter &submitter = context.immediate;
+    if (--submitter.batchDepth > 0 || submitter.recordingSlot < 0) {
+        return submitter.lastTicket;
+    }
+
+    return SubmitRecording(&submitter);
+}
+
+void ReleaseAfterSubmit(const Buffer &buffer) {
+    ReleaseAfterSubmit([buffer]() mutable { DestroyBuffer(&buffer); });
+}
+
+void ReleaseAfterSubmit(Deleter deleter) {
+    ImmediateSubmitter &submitter = context.immediate;
+    // With nothing recording the deleter gets its own empty submission, which the queue still orders
+    // after everything submitted before it.
+    bool standalone = submitter.recordingSlot < 0 && submitter.batchDepth == 0;
+    if (submitter.recordingSlot < 0) {
+        BeginSingleUseCmd();
+    }
+
+    PushDeleter(&submitter.slots[submitter.recordingSlot].deletionQueue, std::move(deleter));
+
+    if (standalone) {
+        SubmitRecording(&submitter);
+    }
+}
+
+void RetireCompletedSubmits() {
+    ImmediateSubmitter &submitter = context.immediate;
+    for (int32_t i = 0; i < (int32_t)ImmediateSlotCount; i++) {
+        ImmediateSlot &slot = submitter.slots[i];
+        if (i != submitter.recordingSlot && !slot.deletionQueue.deleters.empty() && vkGetFenceStatus(context.device, slot.fence) == VK_SUCCESS) {
+            FlushDeletionQueue(&slot.deletionQueue);
+        }
+    }
+}
+
+bool IsTicketComplete(SubmitTicket ticket) {
+    ImmediateSubmitter &submitter = context.immediate;
+    for (int32_t i = 0; i < (int32_t)ImmediateSlotCount; i++) {
+        const ImmediateSlot &slot = submitter.slots[i];
+        if (slot.ticket == 0 || slot.ticket > ticket) {
+            continue;
+        }
+
+        if (i == submitter.recordingSlot || vkGetFenceStatus(context.device, slot.fence) != VK_SUCCESS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void WaitForTicket(SubmitTicket ticket) {
+    ImmediateSubmitter &submitter = context.immediate;
+    // Submitting the open recording here would leave its callers holding a command buffer that is
+    // already in flight, and its fence won't signal until it is submitted.
+    assert(submitter.recordingSlot < 0 || submitter.slots[submitter.recordingSlot].ticket > ticket);
+
+    for (int32_t i = 0; i < (int32_t)ImmediateSlotCount; i++) {
+        const ImmediateSlot &slot = submitter.slots[i];
+        if (i != submitter.recordingSlot && slot.ticket != 0 && slot.ticket <= ticket) {
+            vkWaitForFences(context.device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
+    }
+}
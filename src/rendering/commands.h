@@ -0,0 +1,75 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Volk/volk.h>
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "buffer.h"
+#include "deletion.h"
+
+// One per recording thread per frame in flight; reset wholesale once the frame's fence signals.
+struct ThreadCommandPool {
+    VkCommandPool pool;
+    std::vector<VkCommandBuffer> buffers;
+    uint32_t used;
+};
+
+using CommandRecorder = std::function<void(VkCommandBuffer cmd)>;
+
+// Monotonic id of an immediate submission; waiting on one also covers every earlier ticket.
+using SubmitTicket = uint64_t;
+
+constexpr uint32_t ImmediateSlotCount = 8;
+
+struct ImmediateSlot {
+    VkCommandBuffer cmd;
+    VkFence fence;
+    SubmitTicket ticket;
+    DeletionQueue deletionQueue;
+};
+
+// Reusable command buffers for uploads and one-off work, recycled round-robin once their fence
+// signals. Main thread only.
+struct ImmediateSubmitter {
+    VkCommandPool pool;
+    std::array<ImmediateSlot, ImmediateSlotCount> slots;
+    uint32_t nextSlot;
+    int32_t recordingSlot;
+    uint32_t batchDepth;
+    SubmitTicket lastTicket;
+};
+
+enum Result : int;
+
+Result CreateThreadCommandPools(std::vector<ThreadCommandPool> *pools, uint32_t threadCount);
+void DestroyThreadCommandPools(std::vector<ThreadCommandPool> *pools);
+void ResetThreadCommandPools(std::vector<ThreadCommandPool> *pools);
+VkCommandBuffer BeginSecondaryCmd(ThreadCommandPool *pool);
+
+Result CreateImmediateSubmitter(ImmediateSubmitter *submitter);
+void DestroyImmediateSubmitter(ImmediateSubmitter *submitter);
+
+// Inside a batch every Begin/End pair records into the same command buffer, submitted by the
+// outermost EndImmediateBatch.
+VkCommandBuffer BeginSingleUseCmd();
+SubmitTicket EndSingleUseCmd(VkCommandBuffer cmd);
+void BeginImmediateBatch();
+SubmitTicket EndImmediateBatch();
+
+// Destroys the object once the submission being recorded completes, or an empty one submitted for it
+// when nothing is recording. That submission is ordered after every earlier frame and immediate
+// submit, so it suits objects replaced mid-frame.
+void ReleaseAfterSubmit(const Buffer &buffer);
+void ReleaseAfterSubmit(Deleter deleter);
+// Runs the deleters of finished submissions without waiting for their slots to be reused.
+void RetireCompletedSubmits();
+bool IsTicketComplete(SubmitTicket ticket);
+// The ticket must already be submitted; waiting on the recording still open is an error.
+void WaitForTicket(SubmitTicket ticket);
+
+void RecordParallel(VkCommandBuffer primary, std::vector<ThreadCommandPool> *pools, const std::vector<CommandRecorder> &recorders);
+
+#endif // COMMANDS_H
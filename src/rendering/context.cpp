@@ -1,9 +1,13 @@
 #include "context.h"
 
 #include "vkutil.h"
+#include "../core/jobs.h"
+#include "../world/world.h"
 
 #include <SDL2/SDL_vulkan.h>
 
+#include <cstring>
+
 #define VMA_STATIC_VULKAN_FUNCTIONS 0
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 0
 #define VMA_IMPLEMENTATION
@@ -66,7 +70,69 @@ static Result CheckLayers(const std::vector<const char *> &layers) {
     }
 }
 
-Result InitializeRenderContext(SDL_Window *window) {
+static Result CreateFramebuffers() {
+    context.framebuffers.clear();
+
+    for (uint32_t i = 0; i < context.swapchain.imageCount; i++) {
+        std::vector<VkImageView> attachments = {
+            context.swapchain.imageViews[i]
+        };
+
+        VkFramebuffer framebuffer;
+        VkFramebufferCreateInfo framebufferInfo = GetFramebufferCreateInfo(context.renderPass, attachments, context.swapchain.extent);
+        VkCheck(vkCreateFramebuffer(context.device, &framebufferInfo, nullptr, &framebuffer));
+
+        context.framebuffers.push_back(framebuffer);
+    }
+
+    return Success;
+}
+
+static Result CreateRenderImages(uint32_t width, uint32_t height) {
+    DestroyImage(&context.renderImage);
+    DestroyImage(&context.gbuffer);
+
+    context.renderImage = CreateImage(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, width, height);
+
+    VkImageUsageFlags gbufferUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+    if (context.settings.renderMode == RenderModeRaster) {
+        gbufferUsage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    }
+    if (context.deviceGroup.deviceCount > 1) {
+        context.gbuffer = CreateImage(VK_FORMAT_R32G32_UINT, gbufferUsage | PeerImageUsage, width, height, 1, MemoryCategoryImages, VK_IMAGE_CREATE_ALIAS_BIT);
+    } else {
+        context.gbuffer = CreateImage(VK_FORMAT_R32G32_UINT, gbufferUsage, width, height);
+    }
+    if (context.renderImage.image == VK_NULL_HANDLE || context.gbuffer.image == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+
+    BindStorageImage(context.computePipeline.set, 0, context.gbuffer);
+    BindStorageImage(context.shadePipeline.set, 0, context.gbuffer);
+    BindStorageImage(context.shadePipeline.set, 1, context.renderImage);
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfo.imageView = context.renderImage.view;
+    imageInfo.sampler = context.renderImageSampler;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(context.quadPipeline.set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr, &imageInfo);
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+
+    SetImageLayout(cmd, context.renderImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    SetImageLayout(cmd, context.gbuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+    EndSingleUseCmd(cmd);
+
+    return ResizeDeviceGroup(&context.deviceGroup, context.gbuffer);
+}
+
+Result InitializeRenderContext(SDL_Window *window, const RenderSettings &settings) {
+    context.window = window;
+    context.settings = settings;
+
     VkCheck(volkInitialize());
 
     uint32_t sdlExtensionCount = 0;
@@ -90,68 +156,125 @@ Result InitializeRenderContext(SDL_Window *window) {
 
     volkLoadInstance(context.instance);
 
-    uint32_t physicalDeviceCount = 0;
-    vkEnumeratePhysicalDevices(context.instance, &physicalDeviceCount, nullptr);
-    std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
-    vkEnumeratePhysicalDevices(context.instance, &physicalDeviceCount, physicalDevices.data());
-
-    for (const auto &device : physicalDevices) {
-        VkPhysicalDeviceProperties props = {};
-        vkGetPhysicalDeviceProperties(device, &props);
-        if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-            context.physicalDevice = device;
-            break;
-        }
-    }
-
-    if (context.physicalDevice == VK_NULL_HANDLE) {
-        return UnsupportedPhysicalDevice;
-    }
-
     if (!SDL_Vulkan_CreateSurface(window, context.instance, &context.surface)) {
         return ErrorCreatingSurface;
     }
 
-    context.queueFamily = UINT32_MAX;
-
-    uint32_t familyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> familyProps(familyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(context.physicalDevice, &familyCount, familyProps.data());
-    for (uint32_t i = 0; i < familyCount; i++) {
-        VkBool32 supported = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(context.physicalDevice, i, context.surface, &supported);
-        if (familyProps[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) && supported) {
-            context.queueFamily = i;
-            break;
+    DeviceCandidate selected = {};
+    ResCheck(SelectPhysicalDevice(settings.device, &selected));
+    context.physicalDevice = selected.physicalDevice;
+    context.deviceProperties = selected.properties;
+    context.caps = selected.caps;
+    context.queueFamily = selected.queueFamily;
+    ScaleRenderSettings(&context.settings, context.caps);
+
+    context.deviceGroup.physicalDevices[0] = context.physicalDevice;
+    context.deviceGroup.deviceCount = 1;
+    if (settings.multiGpu) {
+        FindDeviceGroup(context.physicalDevice, &context.deviceGroup);
+        if (context.deviceGroup.deviceCount < 2) {
+            printf("No device group with more than one GPU found, rendering on one device\n");
         }
     }
+    bool splitFrame = context.deviceGroup.deviceCount > 1;
 
-    if (context.queueFamily == UINT32_MAX) {
-        return UnsupportedQueueFamily;
-    }
+    // With one frame in flight, peers can't overwrite device 0's gbuffer while it still shades the
+    // previous frame.
+    context.framesInFlight = settings.lowLatency || splitFrame ? 1 : MaxFramesInFlight;
 
     std::vector<const char *> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
     ResCheck(CheckExtensions(deviceExtensions, context.physicalDevice));
 
+    context.memory.budgetExtension = CheckExtensions({ VK_EXT_MEMORY_BUDGET_EXTENSION_NAME }, context.physicalDevice) == Success;
+    if (context.memory.budgetExtension) {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    VkPhysicalDeviceVulkan12Features supported12 = {};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supported = {};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = &supported12;
+
+    bool presentExtensions = CheckExtensions({ VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME }, context.physicalDevice) == Success;
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {};
+    supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {};
+    supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (presentExtensions) {
+        supported12.pNext = &supportedPresentId;
+        supportedPresentId.pNext = &supportedPresentWait;
+    }
+
+    vkGetPhysicalDeviceFeatures2(context.physicalDevice, &supported);
+
+    // Bindless heap: runtime-sized, partially bound arrays updated while in use. SelectPhysicalDevice
+    // has already rejected devices without them.
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.bufferDeviceAddress = supported12.bufferDeviceAddress && (!splitFrame || supported12.bufferDeviceAddressMultiDevice);
+    features12.bufferDeviceAddressMultiDevice = splitFrame && features12.bufferDeviceAddress;
+    context.bufferDeviceAddress = features12.bufferDeviceAddress == VK_TRUE;
+
+    // Present ids let the low latency mode pace the CPU against the display instead of the fences.
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = VK_TRUE;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+
+    context.presentWait = presentExtensions && supportedPresentId.presentId && supportedPresentWait.presentWait;
+    if (context.presentWait) {
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        features12.pNext = &presentIdFeatures;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+    }
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    features.features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    features.features.shaderStorageImageArrayDynamicIndexing = VK_TRUE;
+    features.features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
     std::vector<VkDeviceQueueCreateInfo> queueInfos = { GetDeviceQueueCreateInfo(context.queueFamily, 1) };
     VkDeviceCreateInfo deviceInfo = GetDeviceCreateInfo(queueInfos, deviceExtensions);
+    deviceInfo.pNext = &features;
+
+    VkDeviceGroupDeviceCreateInfo groupInfo = {};
+    groupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO;
+    groupInfo.pNext = &features;
+    groupInfo.physicalDeviceCount = context.deviceGroup.deviceCount;
+    groupInfo.pPhysicalDevices = context.deviceGroup.physicalDevices.data();
+    if (splitFrame) {
+        deviceInfo.pNext = &groupInfo;
+    }
 
     VkCheck(vkCreateDevice(context.physicalDevice, &deviceInfo, nullptr, &context.device));
     vkGetDeviceQueue(context.device, context.queueFamily, 0, &context.queue);
 
-    ResCheck(CreateSwapchain(&context.swapchain, true));
+    ResCheck(CreateSwapchain(&context.swapchain, true, settings.lowLatency));
 
     VkCommandPoolCreateInfo poolInfo = GetCommandPoolCreateInfo(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, context.queueFamily);
     VkCheck(vkCreateCommandPool(context.device, &poolInfo, nullptr, &context.commandPool));
+    ResCheck(CreateImmediateSubmitter(&context.immediate));
 
     std::vector<VkDescriptorPoolSize> poolSizes = {
-        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 10 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 64 },
         { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 128 },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 16 },
     };
-    VkDescriptorPoolCreateInfo descriptorPoolInfo = GetDescriptorPoolCreateInfo(30, poolSizes);
+    VkDescriptorPoolCreateInfo descriptorPoolInfo = GetDescriptorPoolCreateInfo(64, poolSizes);
     VkCheck(vkCreateDescriptorPool(context.device, &descriptorPoolInfo, nullptr, &context.descriptorPool));
+    ResCheck(CreateBindlessHeap(&context.bindless));
 
     VmaVulkanFunctions functions = {};
     functions.vkGetPhysicalDeviceProperties = vkGetPhysicalDeviceProperties;
@@ -181,6 +304,12 @@ Result InitializeRenderContext(SDL_Window *window) {
 
     VmaAllocatorCreateInfo allocatorInfo = {};
     allocatorInfo.flags = 0;
+    if (context.bufferDeviceAddress) {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    }
+    if (context.memory.budgetExtension) {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
     allocatorInfo.physicalDevice = context.physicalDevice;
     allocatorInfo.device = context.device;
     allocatorInfo.pVulkanFunctions = &functions;
@@ -188,6 +317,10 @@ Result InitializeRenderContext(SDL_Window *window) {
     allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
 
     VkCheck(vmaCreateAllocator(&allocatorInfo, &context.allocator));
+    ResCheck(CreateMemoryPools(&context.memory));
+
+    ResCheck(CreateFrameConstantsRing(&context.frameConstants));
+    ResCheck(CreateScene(&context.scene));
 
     VkAttachmentDescription colorAttachment = {};
     colorAttachment.flags = 0;
@@ -222,48 +355,26 @@ Result InitializeRenderContext(SDL_Window *window) {
     VkRenderPassCreateInfo renderPassInfo = GetRenderPassCreateInfo(attachments, subpasses, dependencies);
     VkCheck(vkCreateRenderPass(context.device, &renderPassInfo, nullptr, &context.renderPass));
 
-    for (uint32_t i = 0; i < context.swapchain.imageCount; i++) {
-        std::vector<VkImageView> attachments = {
-            context.swapchain.imageViews[i]
-        };
+    ResCheck(CreateFramebuffers());
 
-        VkFramebuffer framebuffer;
-        VkFramebufferCreateInfo framebufferInfo = GetFramebufferCreateInfo(context.renderPass, attachments, context.swapchain.extent);
-        VkCheck(vkCreateFramebuffer(context.device, &framebufferInfo, nullptr, &framebuffer));
+    std::vector<std::string> marchDefines = GetVoxelShaderDefines();
+    std::vector<std::string> subgroupDefines = GetSubgroupShaderDefines();
+    marchDefines.insert(marchDefines.end(), subgroupDefines.begin(), subgroupDefines.end());
 
-        context.framebuffers.push_back(framebuffer);
-    }
-    
-    context.computePipeline = CreateComputePipeline("../../res/shaders/voxel.comp");
+    context.computePipeline = CreateComputePipeline("../../res/shaders/voxel.comp", marchDefines);
     context.quadPipeline = CreateGraphicsPipeline({"../../res/shaders/screenquad.vert", "../../res/shaders/screenquad.frag"}, context.renderPass);
-    context.renderImage = CreateImage(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, context.swapchain.extent.width, context.swapchain.extent.height);
+    context.shadePipeline = CreateComputePipeline("../../res/shaders/shade.comp");
+    ResCheck(CreateDispatchArgsPipeline(&context.dispatchArgsPipeline));
+    BindFrameConstants(context.computePipeline.set, 5, context.frameConstants);
+    BindFrameConstants(context.shadePipeline.set, 5, context.frameConstants);
 
     VkSamplerCreateInfo samplerInfo = GetSamplerCreateInfo();
     VkCheck(vkCreateSampler(context.device, &samplerInfo, nullptr, &context.renderImageSampler));
 
-    VkDescriptorImageInfo imageInfo = {};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    imageInfo.imageView = context.renderImage.view;
-    
-    VkWriteDescriptorSet write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = nullptr;
-    write.dstSet = context.computePipeline.set;
-    write.dstBinding = 0;
-    write.dstArrayElement = 0;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    write.pImageInfo = &imageInfo;
-    write.pBufferInfo = nullptr;
-    write.pTexelBufferView = nullptr;
-    
-    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
-    
-    write.dstSet = context.quadPipeline.set;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    imageInfo.sampler = context.renderImageSampler;
+    ResCheck(CreateRenderImages(context.swapchain.extent.width, context.swapchain.extent.height));
 
-    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+    context.materialPaletteHandle = InvalidBindlessHandle;
+    ResCheck(UploadMaterialPalette({}));
 
     for (auto &frame : context.frames) {
         frame.graphicsCmd = AllocateCommandBuffer();
@@ -273,95 +384,649 @@ Result InitializeRenderContext(SDL_Window *window) {
         frame.computeFence = CreateFence(VK_FENCE_CREATE_SIGNALED_BIT);
         frame.imageAvailableSemaphore = CreateSemaphore();
         frame.computeDoneSemaphore = CreateSemaphore();
+
+        if (splitFrame) {
+            frame.bandCmd = AllocateCommandBuffer();
+            for (uint32_t i = 0; i < context.deviceGroup.deviceCount; i++) {
+                frame.bandSemaphores[i] = CreateSemaphore();
+            }
+        }
+
+        ResCheck(CreateThreadCommandPools(&frame.threadPools, GetJobThreadCount()));
     }
 
-    VkCommandBuffer cmd = BeginSingleUseCmd();
+    ResCheck(CreateDistanceField(&context.distanceField));
+    BindStorageBuffer(context.computePipeline.set, 2, context.distanceField.distances);
 
-    SetImageLayout(cmd, context.renderImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    ResCheck(CreateOccupancyPyramid(&context.occupancyPyramid));
+    BindStorageBuffer(context.computePipeline.set, 3, context.occupancyPyramid.cells);
 
-    EndSingleUseCmd(cmd);
+    ResCheck(CreateLightingPass(&context.lightingPass, context.gbuffer.width, context.gbuffer.height));
+    BindStorageImage(context.shadePipeline.set, 3, context.lightingPass.history[0]);
+    BindStorageImage(context.shadePipeline.set, 4, context.lightingPass.history[1]);
+
+    ResCheck(CreateWavefrontPass(&context.wavefrontPass, context.renderImage.width, context.renderImage.height));
+
+    ResCheck(CreateTilePass(&context.tilePass, context.renderImage.width, context.renderImage.height));
+    BindStorageBuffer(context.computePipeline.set, 4, context.tilePass.tileList.buffer);
+
+    ResCheck(CreatePickPass(&context.pickPass));
+    for (auto &frame : context.frames) {
+        ResCheck(CreatePickSlot(&frame.pickSlot));
+    }
+
+    if (context.settings.renderMode == RenderModeRaster) {
+        ResCheck(CreateMeshPass(&context.meshPass, context.gbuffer.width, context.gbuffer.height));
+    }
+
+    context.marchMode = settings.marchMode;
+    context.camera = GetOrbitCamera(0.0f);
 
     return Success;
 }
 
-void UploadVoxelData(const std::vector<int> &data) {
-    context.voxelData = CreateBuffer(sizeof(int) * data.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-    CopyToBuffer(&context.voxelData, (uint8_t*)data.data(), sizeof(int) * data.size());
-
-    VkDescriptorBufferInfo bufferInfo = {};
-    bufferInfo.buffer = context.voxelData.buffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range = VK_WHOLE_SIZE;
-
-    VkWriteDescriptorSet write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = nullptr;
-    write.dstSet = context.computePipeline.set;
-    write.dstBinding = 1;
-    write.dstArrayElement = 0;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    write.pImageInfo = nullptr;
-    write.pBufferInfo = &bufferInfo;
-    write.pTexelBufferView = nullptr;
+static uint32_t SpreadBits(uint32_t v) {
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
 
-    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+static uint32_t GetMortonIndex(glm::ivec3 pos) {
+    return SpreadBits(pos.x) | (SpreadBits(pos.y) << 1) | (SpreadBits(pos.z) << 2);
+}
+
+static uint32_t GetMortonSide() {
+    uint32_t side = 1;
+    while (side < (uint32_t)glm::max(VoxelGridWidth, glm::max(VoxelGridHeight, VoxelGridDepth))) {
+        side *= 2;
+    }
+
+    return side;
+}
+
+static uint32_t GetLinearIndex(glm::ivec3 pos) {
+    return pos.x + pos.y * VoxelGridWidth + pos.z * VoxelGridWidth * VoxelGridHeight;
+}
+
+static void PackVoxelRows(const std::vector<int> &data, glm::ivec3 min, glm::ivec3 max, std::vector<int> &rows) {
+    for (int z = min.z; z < max.z; z++) {
+        for (int y = min.y; y < max.y; y++) {
+            uint32_t index = GetLinearIndex(glm::ivec3(min.x, y, z));
+            rows.insert(rows.end(), data.begin() + index, data.begin() + index + (max.x - min.x));
+        }
+    }
+}
+
+static VkBufferImageCopy GetVoxelImageCopy(glm::ivec3 min, glm::ivec3 max) {
+    VkBufferImageCopy copy = {};
+    copy.bufferOffset = 0;
+    copy.bufferRowLength = 0;
+    copy.bufferImageHeight = 0;
+    copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.imageSubresource.mipLevel = 0;
+    copy.imageSubresource.baseArrayLayer = 0;
+    copy.imageSubresource.layerCount = 1;
+    copy.imageOffset = {min.x, min.y, min.z};
+    copy.imageExtent = {(uint32_t)(max.x - min.x), (uint32_t)(max.y - min.y), (uint32_t)(max.z - min.z)};
+
+    return copy;
+}
+
+// Buffer layouts are read through device addresses in push constants when the device allows it,
+// so replacing the voxel buffer never touches descriptor sets.
+bool UseVoxelAddress() {
+    return context.bufferDeviceAddress && context.settings.voxelLayout != VoxelLayoutImage;
+}
+
+std::vector<std::string> GetVoxelShaderDefines() {
+    std::vector<std::string> defines;
+    switch (context.settings.voxelLayout) {
+        case VoxelLayoutMorton: defines.push_back("VOXEL_LAYOUT_MORTON"); break;
+        case VoxelLayoutImage: defines.push_back("VOXEL_LAYOUT_IMAGE"); break;
+        default: break;
+    }
+
+    if (UseVoxelAddress()) {
+        defines.push_back("VOXEL_BUFFER_ADDRESS");
+    }
+
+    return defines;
+}
+
+static VkBufferUsageFlags GetVoxelBufferUsage() {
+    // Transfer source so the defragmenter can copy it to a new place.
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (UseVoxelAddress()) {
+        usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    }
+
+    return usage;
+}
+
+void BindVoxelStorage(VkDescriptorSet set, uint32_t binding) {
+    if (UseVoxelAddress()) {
+        return;
+    }
+
+    if (context.settings.voxelLayout == VoxelLayoutImage) {
+        BindStorageImage(set, binding, context.voxelImage);
+    } else {
+        BindStorageBuffer(set, binding, context.voxelData);
+    }
+}
+
+static void WaitForFramesInFlight() {
+    for (auto &frame : context.frames) {
+        std::array<VkFence, 2> fences = {frame.computeFence, frame.renderFence};
+        vkWaitForFences(context.device, (uint32_t)fences.size(), fences.data(), VK_TRUE, UINT64_MAX);
+    }
+}
+
+// Storage replaced by an upload may still be read by earlier immediate submits, so it is released
+// after the upload's own submit rather than with a frame.
+static void ReleaseVoxelStorage(Buffer buffer, Image image) {
+    if (buffer.buffer == VK_NULL_HANDLE && image.image == VK_NULL_HANDLE) {
+        return;
+    }
+
+    context.defragmenter.pendingFrees++;
+    ReleaseAfterSubmit([buffer, image]() mutable {
+        DestroyBuffer(&buffer);
+        DestroyImage(&image);
+        context.defragmenter.pendingFrees--;
+    });
+}
+
+static void RebuildVoxelAccelerations(glm::ivec3 min, glm::ivec3 max) {
+    context.dirtyRegions.push_back({glm::ivec4(min, 0), glm::ivec4(max, 0)});
 
     VkCommandBuffer cmd = BeginSingleUseCmd();
 
-    VkBufferMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.buffer = context.voxelData.buffer;
-    barrier.offset = 0;
-    barrier.size = VK_WHOLE_SIZE;
-
-    vkCmdPipelineBarrier(
-        cmd,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        0,
-        0, nullptr,
-        1, &barrier,
-        0, nullptr
-    );
+    if (context.settings.voxelLayout != VoxelLayoutImage) {
+        BufferBarrier(cmd, context.voxelData, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    BuildDistanceField(cmd, &context.distanceField, min, max);
+    BuildOccupancyPyramid(cmd, &context.occupancyPyramid, min, max);
 
     EndSingleUseCmd(cmd);
 }
 
+Result UploadVoxelData(const std::vector<int> &data) {
+    glm::ivec3 gridSize(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth);
+
+    // A replacement holds both grids until the batch retires, which would push a nearly full device over budget.
+    bool replacing = context.voxelData.buffer != VK_NULL_HANDLE || context.voxelImage.image != VK_NULL_HANDLE;
+    if (replacing && GetMemoryPressure() > MemoryPressureWarning) {
+        printf("Refusing to replace the voxel grid at %.0f%% of the GPU memory budget\n", GetMemoryPressure() * 100.0f);
+        return ErrorAllocatingMemory;
+    }
+
+    FlushDefragmentation();
+
+    // Rebinding below rewrites descriptor sets that frames in flight may still be using.
+    Buffer previousData = context.voxelData;
+    Image previousImage = context.voxelImage;
+    if (replacing) {
+        WaitForFramesInFlight();
+    }
+    context.voxelData = {};
+    context.voxelImage = {};
+
+    BeginImmediateBatch();
+
+    Result result = ErrorAllocatingMemory;
+    switch (context.settings.voxelLayout) {
+        case VoxelLayoutLinear: {
+            context.voxelData = CreateBuffer(sizeof(int) * data.size(), GetVoxelBufferUsage(), VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryVoxels);
+            if (context.voxelData.buffer == VK_NULL_HANDLE) {
+                break;
+            }
+            result = CopyToBuffer(&context.voxelData, (uint8_t*)data.data(), sizeof(int) * data.size());
+        } break;
+        case VoxelLayoutMorton: {
+            uint32_t side = GetMortonSide();
+            std::vector<int> morton(side * side * side, 0);
+            for (int z = 0; z < gridSize.z; z++) {
+                for (int y = 0; y < gridSize.y; y++) {
+                    for (int x = 0; x < gridSize.x; x++) {
+                        glm::ivec3 pos(x, y, z);
+                        morton[GetMortonIndex(pos)] = data[GetLinearIndex(pos)];
+                    }
+                }
+            }
+
+            context.voxelData = CreateBuffer(sizeof(int) * morton.size(), GetVoxelBufferUsage(), VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryVoxels);
+            if (context.voxelData.buffer == VK_NULL_HANDLE) {
+                break;
+            }
+            result = CopyToBuffer(&context.voxelData, (uint8_t*)morton.data(), sizeof(int) * morton.size());
+        } break;
+        case VoxelLayoutImage: {
+            context.voxelImage = CreateImage(VK_FORMAT_R32_SINT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT, gridSize.x, gridSize.y, gridSize.z, MemoryCategoryVoxels);
+            if (context.voxelImage.image == VK_NULL_HANDLE) {
+                break;
+            }
+            result = CopyToImage(&context.voxelImage, (uint8_t*)data.data(), sizeof(int) * data.size(), {GetVoxelImageCopy(glm::ivec3(0), gridSize)}, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        } break;
+    }
+
+    if (result != Success) {
+        // A failed copy records nothing, so the new storage can go straight away.
+        DestroyBuffer(&context.voxelData);
+        DestroyImage(&context.voxelImage);
+        context.voxelData = previousData;
+        context.voxelImage = previousImage;
+        EndImmediateBatch();
+        return result;
+    }
+    SetWorldVoxels(gridSize, data);
+
+    // Only address-based reads can follow a move; descriptor sets of frames in flight can't be rewritten.
+    if (UseVoxelAddress()) {
+        RegisterMovableBuffer(&context.voxelData, GetVoxelBufferUsage());
+    }
+
+    BindVoxelStorage(context.computePipeline.set, 1);
+    BindVoxelStorage(context.distanceField.pipeline.set, 0);
+    BindVoxelStorage(context.occupancyPyramid.pipeline.set, 0);
+    BindVoxelStorage(context.lightingPass.lightingPipeline.set, 2);
+    BindVoxelStorage(context.pickPass.pipeline.set, 1);
+    BindWavefrontVoxels(&context.wavefrontPass);
+
+    RebuildVoxelAccelerations(glm::ivec3(0), gridSize);
+    if (context.settings.renderMode == RenderModeRaster) {
+        result = RemeshChunks(&context.meshPass, data, glm::ivec3(0), gridSize);
+    }
+    ReleaseVoxelStorage(previousData, previousImage);
+
+    EndImmediateBatch();
+    return result;
+}
+
+Result UpdateVoxelData(const std::vector<int> &data, glm::ivec3 min, glm::ivec3 max) {
+    min = glm::max(min, glm::ivec3(0));
+    max = glm::min(max, glm::ivec3(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth));
+    if (glm::any(glm::greaterThanEqual(min, max))) {
+        return Success;
+    }
+
+    FlushDefragmentation();
+    BeginImmediateBatch();
+
+    Result result = Success;
+    switch (context.settings.voxelLayout) {
+        case VoxelLayoutLinear: {
+            std::vector<int> rows;
+            PackVoxelRows(data, min, max, rows);
+
+            std::vector<VkBufferCopy> regions;
+            uint32_t rowLength = max.x - min.x;
+            for (int z = min.z; z < max.z; z++) {
+                for (int y = min.y; y < max.y; y++) {
+                    VkBufferCopy copy = {};
+                    copy.srcOffset = sizeof(int) * rowLength * regions.size();
+                    copy.dstOffset = sizeof(int) * GetLinearIndex(glm::ivec3(min.x, y, z));
+                    copy.size = sizeof(int) * rowLength;
+                    regions.push_back(copy);
+                }
+            }
+
+            result = CopyToBuffer(&context.voxelData, (uint8_t*)rows.data(), sizeof(int) * rows.size(), regions);
+        } break;
+        case VoxelLayoutMorton: {
+            // Aligned blocks are contiguous in Morton order, so each one is a single copy region.
+            glm::ivec3 blockMin = min / MortonUpdateBlock;
+            glm::ivec3 blockMax = (max + MortonUpdateBlock - 1) / MortonUpdateBlock;
+            uint32_t blockVolume = MortonUpdateBlock * MortonUpdateBlock * MortonUpdateBlock;
+
+            std::vector<int> blocks;
+            std::vector<VkBufferCopy> regions;
+            for (int bz = blockMin.z; bz < blockMax.z; bz++) {
+                for (int by = blockMin.y; by < blockMax.y; by++) {
+                    for (int bx = blockMin.x; bx < blockMax.x; bx++) {
+                        glm::ivec3 origin = glm::ivec3(bx, by, bz) * MortonUpdateBlock;
+                        size_t base = blocks.size();
+                        blocks.resize(base + blockVolume, 0);
+
+                        for (int z = 0; z < MortonUpdateBlock; z++) {
+                            for (int y = 0; y < MortonUpdateBlock; y++) {
+                                for (int x = 0; x < MortonUpdateBlock; x++) {
+                                    glm::ivec3 pos = origin + glm::ivec3(x, y, z);
+                                    if (pos.x < VoxelGridWidth && pos.y < VoxelGridHeight && pos.z < VoxelGridDepth) {
+                                        blocks[base + GetMortonIndex(glm::ivec3(x, y, z))] = data[GetLinearIndex(pos)];
+                                    }
+                                }
+                            }
+                        }
+
+                        VkBufferCopy copy = {};
+                        copy.srcOffset = sizeof(int) * base;
+                        copy.dstOffset = sizeof(int) * GetMortonIndex(origin);
+                        copy.size = sizeof(int) * blockVolume;
+                        regions.push_back(copy);
+                    }
+                }
+            }
+
+            result = CopyToBuffer(&context.voxelData, (uint8_t*)blocks.data(), sizeof(int) * blocks.size(), regions);
+        } break;
+        case VoxelLayoutImage: {
+            std::vector<int> rows;
+            PackVoxelRows(data, min, max, rows);
+
+            result = CopyToImage(&context.voxelImage, (uint8_t*)rows.data(), sizeof(int) * rows.size(), {GetVoxelImageCopy(min, max)}, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+        } break;
+    }
+
+    // The CPU copy only follows once the GPU one has, so CPU queries never disagree with the grid.
+    if (result != Success) {
+        EndImmediateBatch();
+        return result;
+    }
+    UpdateWorldVoxels(data, min, max);
+
+    RebuildVoxelAccelerations(min, max);
+    if (context.settings.renderMode == RenderModeRaster) {
+        result = RemeshChunks(&context.meshPass, data, min, max);
+    }
+
+    EndImmediateBatch();
+    return result;
+}
+
+static Result ResizeRenderTargets(uint32_t width, uint32_t height) {
+    ResCheck(CreateRenderImages(width, height));
+
+    ResCheck(ResizeLightingPass(&context.lightingPass, width, height));
+    BindStorageImage(context.shadePipeline.set, 3, context.lightingPass.history[0]);
+    BindStorageImage(context.shadePipeline.set, 4, context.lightingPass.history[1]);
+
+    ResCheck(ResizeWavefrontPass(&context.wavefrontPass, width, height));
+
+    ResCheck(ResizeTilePass(&context.tilePass, width, height));
+    BindStorageBuffer(context.computePipeline.set, 4, context.tilePass.tileList.buffer);
+    BindStorageImage(context.pickPass.pipeline.set, 0, context.gbuffer);
+    if (context.settings.renderMode == RenderModeRaster) {
+        ResCheck(ResizeMeshPass(&context.meshPass, width, height));
+    }
+
+    context.historyStartFrame = context.frameCount;
+
+    return Success;
+}
+
+// Waits on this renderer's own frames only; the old swapchain lives on until its last presents retire.
+static Result RecreateSwapchain() {
+    int width = 0, height = 0;
+    SDL_Vulkan_GetDrawableSize(context.window, &width, &height);
+    if (width == 0 || height == 0) {
+        return Success;
+    }
+
+    WaitForFramesInFlight();
+
+    RetiredSwapchain retired = {};
+    retired.swapchain = context.swapchain;
+    retired.framebuffers = context.framebuffers;
+    retired.retireFrame = context.frameCount + MaxFramesInFlight + 1;
+
+    ResCheck(CreateSwapchain(&context.swapchain, retired.swapchain.vsync, context.settings.lowLatency, retired.swapchain.swapchain));
+    if (context.swapchain.swapchain == VK_NULL_HANDLE) {
+        context.swapchain = retired.swapchain;
+        return Success;
+    }
+
+    context.retiredSwapchains.push_back(retired);
+    context.swapchainDirty = false;
+    ResCheck(CreateFramebuffers());
+
+    VkExtent2D extent = context.swapchain.extent;
+    if (extent.width != context.renderImage.width || extent.height != context.renderImage.height) {
+        ResCheck(ResizeRenderTargets(extent.width, extent.height));
+    }
+
+    return Success;
+}
+
+static void DestroyRetiredSwapchains() {
+    auto &retired = context.retiredSwapchains;
+    for (size_t i = 0; i < retired.size();) {
+        if (context.frameCount < retired[i].retireFrame) {
+            i++;
+            continue;
+        }
+
+        for (auto framebuffer : retired[i].framebuffers) {
+            vkDestroyFramebuffer(context.device, framebuffer, nullptr);
+        }
+        SwapchainDestroy(&retired[i].swapchain);
+        retired.erase(retired.begin() + i);
+    }
+}
+
+static void RecordMarchPass(VkCommandBuffer cmd, const ComputePushConstants &push, bool invalidateAll, uint32_t bandMin, uint32_t bandMax) {
+    TilePushConstants tilePush = {};
+    tilePush.invalidateAll = invalidateAll;
+    tilePush.bandMin = (int32_t)bandMin;
+    tilePush.bandMax = (int32_t)bandMax;
+
+    RecordTilePass(cmd, &context.tilePass, tilePush, context.dirtyRegions);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, context.computePipeline.pipeline);
+    BindDescriptorSets(cmd, context.computePipeline);
+    vkCmdPushConstants(cmd, context.computePipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    DispatchIndirect(cmd, context.tilePass.tileList, 0);
+
+    SetImageLayout(cmd, context.gbuffer, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+// Every device marks and marches the tiles of its own band, then copies the band into device 0's
+// gbuffer. Device 0's compute submit waits on one semaphore per device.
+static Result SubmitBands(FrameData &frame, const ComputePushConstants &push, bool invalidateAll) {
+    const DeviceGroup &group = context.deviceGroup;
+
+    VkCommandBufferBeginInfo beginInfo = GetCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkBeginCommandBuffer(frame.bandCmd, &beginInfo);
+
+    for (uint32_t device = 0; device < group.deviceCount; device++) {
+        vkCmdSetDeviceMask(frame.bandCmd, 1u << device);
+        RecordMarchPass(frame.bandCmd, push, invalidateAll, group.bandRows[device], group.bandRows[device + 1]);
+        if (device > 0) {
+            CopyBandToPeer(frame.bandCmd, group, context.gbuffer, device);
+        }
+    }
+
+    vkCmdSetDeviceMask(frame.bandCmd, GetAllDevicesMask(group));
+    vkEndCommandBuffer(frame.bandCmd);
+
+    std::array<uint32_t, MaxGroupDevices> signalIndices = {};
+    for (uint32_t i = 0; i < group.deviceCount; i++) {
+        signalIndices[i] = i;
+    }
+
+    uint32_t deviceMask = GetAllDevicesMask(group);
+    VkDeviceGroupSubmitInfo groupInfo = {};
+    groupInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO;
+    groupInfo.commandBufferCount = 1;
+    groupInfo.pCommandBufferDeviceMasks = &deviceMask;
+    groupInfo.signalSemaphoreCount = group.deviceCount;
+    groupInfo.pSignalSemaphoreDeviceIndices = signalIndices.data();
+
+    std::vector<VkSemaphore> signalSemaphores(frame.bandSemaphores.begin(), frame.bandSemaphores.begin() + group.deviceCount);
+    VkSubmitInfo submitInfo = GetSubmitInfo(&frame.bandCmd, {}, {}, signalSemaphores);
+    submitInfo.pNext = &groupInfo;
+    VkCheck(vkQueueSubmit(context.queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    return Success;
+}
+
 Result RenderFrame() {
-    FrameData &frame = context.frames[context.frameCount % MaxFramesInFlight];
+    DestroyRetiredSwapchains();
 
-    vkWaitForFences(context.device, 1, &frame.computeFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(context.device, 1, &frame.computeFence);
+    if (context.swapchainDirty) {
+        ResCheck(RecreateSwapchain());
+        if (context.swapchainDirty) {
+            return Success;
+        }
+    }
+
+    FrameData &frame = context.frames[context.frameCount % context.framesInFlight];
+
+    // Start the frame only once the previous one is on screen, so input is sampled right before
+    // recording rather than a queue's worth of frames ahead of the display.
+    if (context.settings.lowLatency && context.presentWait && context.swapchain.presentId > 0) {
+        vkWaitForPresentKHR(context.device, context.swapchain.swapchain, context.swapchain.presentId, PresentWaitTimeout);
+    }
 
-    float time = SDL_GetTicks();
+    std::array<VkFence, 2> fences = {frame.computeFence, frame.renderFence};
+    vkWaitForFences(context.device, (uint32_t)fences.size(), fences.data(), VK_TRUE, UINT64_MAX);
+    FlushDeletionQueue(&frame.deletionQueue);
+    RetireCompletedSubmits();
+    CollectPickResults(&frame.pickSlot);
+
+    uint32_t imageIndex;
+    VkResult acquired = vkAcquireNextImageKHR(context.device, context.swapchain.swapchain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    if (acquired == VK_ERROR_OUT_OF_DATE_KHR) {
+        context.swapchainDirty = true;
+        return Success;
+    } else if (acquired == VK_SUBOPTIMAL_KHR) {
+        context.swapchainDirty = true;
+    } else {
+        VkCheck(acquired);
+    }
+
+    vkResetFences(context.device, 1, &frame.renderFence);
+    ResetThreadCommandPools(&frame.threadPools);
+    UpdateMemoryBudget(context.frameCount);
+    UpdateDefragmentation(context.frameCount);
+
+    if (context.cameraSource) {
+        context.camera = context.cameraSource();
+    }
+
+    ComputePushConstants push = {};
+    push.marchMode = context.marchMode;
+    push.lodScale = context.settings.lodScale;
+    push.voxelAddress = context.voxelData.address;
+
+    FrameConstants constants = {};
+    constants.camera = GetCameraConstants(context.camera, context.renderImage.width, context.renderImage.height);
+    constants.prevCamera = context.frameCount > 0 ? context.lastCamera : constants.camera;
+    constants.screenSize = glm::ivec2(context.renderImage.width, context.renderImage.height);
+    constants.frameIndex = context.frameCount;
+    UpdateScene(context.frameCount % MaxFramesInFlight, &constants);
+    WriteFrameConstants(&context.frameConstants, context.frameCount % MaxFramesInFlight, constants);
+
+    bool cameraMoved = context.frameCount == 0 || std::memcmp(&constants.camera, &context.lastCamera, sizeof(CameraConstants)) != 0;
+    bool sceneChanged = !context.dirtyRegions.empty() || context.scene.moved;
+    // Dirty regions are in grid space; with instances an edit can show up anywhere on screen.
+    bool invalidateAll = cameraMoved || context.scene.moved || (sceneChanged && constants.instanceCount > 0);
+    context.settledFrames = (cameraMoved || sceneChanged) ? 0 : context.settledFrames + 1;
 
     VkCommandBufferBeginInfo beginInfo = GetCommandBufferBeginInfo(0);
     vkBeginCommandBuffer(frame.computeCmd, &beginInfo);
 
-    vkCmdBindPipeline(frame.computeCmd, VK_PIPELINE_BIND_POINT_COMPUTE, context.computePipeline.pipeline);
-    vkCmdBindDescriptorSets(frame.computeCmd, VK_PIPELINE_BIND_POINT_COMPUTE, context.computePipeline.layout, 0, 1, &context.computePipeline.set, 0, nullptr);
-    vkCmdPushConstants(frame.computeCmd, context.computePipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(time), &time);
+    // Frames in flight share the screen-sized images, so order against the previous frame's reads.
+    SetImageLayout(frame.computeCmd, context.renderImage, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+
+    // Passes are recorded into secondary buffers in parallel and executed in list order.
+    std::vector<CommandRecorder> passes;
+    bool splitFrame = context.deviceGroup.deviceCount > 1;
+    bool bandsSubmitted = false;
+    bool rasterize = false;
+
+    if (context.settings.renderMode == RenderModeWavefront) {
+        passes.push_back([&](VkCommandBuffer cmd) {
+            WavefrontPushConstants wavefrontPush = {};
+            wavefrontPush.frameIndex = context.frameCount;
+            wavefrontPush.maxBounces = context.settings.maxBounces;
+            wavefrontPush.marchMode = context.marchMode;
+            wavefrontPush.palette = context.materialPaletteHandle;
+            wavefrontPush.voxelAddress = context.voxelData.address;
+
+            RecordWavefrontPass(cmd, &context.wavefrontPass, wavefrontPush);
+        });
+    } else if (context.settledFrames < LightingSettleFrames) {
+        if (context.settings.renderMode == RenderModeRaster) {
+            rasterize = cameraMoved || sceneChanged;
+        } else if ((cameraMoved || sceneChanged) && splitFrame) {
+            ResCheck(SubmitBands(frame, push, invalidateAll));
+            bandsSubmitted = true;
+        } else if (cameraMoved || sceneChanged) {
+            passes.push_back([&](VkCommandBuffer cmd) {
+                RecordMarchPass(cmd, push, invalidateAll, 0, context.renderImage.height);
+            });
+        }
 
-    vkCmdDispatch(frame.computeCmd, context.renderImage.width / 16, context.renderImage.height / 16, 1);
+        passes.push_back([&](VkCommandBuffer cmd) {
+            LightingPushConstants lightingPush = {};
+            lightingPush.frameIndex = context.frameCount;
+            lightingPush.rayBudget = context.settings.rayBudget;
+            lightingPush.maxRaysPerPixel = context.settings.maxRaysPerPixel;
+            lightingPush.marchMode = context.marchMode;
+            lightingPush.historyValid = context.frameCount > context.historyStartFrame;
+            lightingPush.voxelAddress = context.voxelData.address;
+
+            RecordLightingPass(cmd, &context.lightingPass, lightingPush);
+        });
+
+        passes.push_back([&](VkCommandBuffer cmd) {
+            ShadePushConstants shadePush = {};
+            shadePush.frameIndex = context.frameCount;
+            shadePush.palette = context.materialPaletteHandle;
+
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, context.shadePipeline.pipeline);
+            BindDescriptorSets(cmd, context.shadePipeline);
+            vkCmdPushConstants(cmd, context.shadePipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(shadePush), &shadePush);
+            vkCmdDispatch(cmd, GetGroupCount(context.renderImage.width, 16), GetGroupCount(context.renderImage.height, 16), 1);
+        });
+    }
+
+    // Picks read whatever G-buffer the frame ends with, including one left over from a settled view.
+    if (context.settings.renderMode == RenderModeWavefront) {
+        DropPickRequests();
+    } else if (AssignPickRequests(&frame.pickSlot) > 0) {
+        passes.push_back([&](VkCommandBuffer cmd) {
+            RecordPickPass(cmd, &context.pickPass, frame.pickSlot, context.voxelData.address);
+        });
+    }
+
+    // A render pass can't begin inside a secondary buffer, so the raster pass goes into the primary ahead of them.
+    if (rasterize) {
+        RecordMeshPass(frame.computeCmd, &context.meshPass, constants.camera.viewProjection);
+    }
+
+    // Once lighting has settled and no picks are queued, the buffer holds only the layout barrier. It
+    // isn't submitted; the compute fence stays signalled and the present reuses the last renderImage.
+    bool computeWork = bandsSubmitted || rasterize || !passes.empty();
+
+    RecordParallel(frame.computeCmd, &frame.threadPools, passes);
 
     vkEndCommandBuffer(frame.computeCmd);
+    context.dirtyRegions.clear();
 
     std::vector<VkSemaphore> waitSemaphores = {};
     std::vector<VkSemaphore> signalSemaphores = {frame.computeDoneSemaphore};
-    std::vector<VkPipelineStageFlags> waitFlags = {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
-    VkSubmitInfo submitInfo = GetSubmitInfo(&frame.computeCmd, waitSemaphores, waitFlags, signalSemaphores);
-    VkCheck(vkQueueSubmit(context.queue, 1, &submitInfo, frame.computeFence));
-
-    vkWaitForFences(context.device, 1, &frame.renderFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(context.device, 1, &frame.renderFence);
-
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(context.device, context.swapchain.swapchain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    std::vector<VkPipelineStageFlags> waitFlags = {};
+    VkSubmitInfo submitInfo = {};
+    VkDeviceGroupSubmitInfo groupSubmitInfo = {};
+    if (computeWork) {
+        if (bandsSubmitted) {
+            waitSemaphores.assign(frame.bandSemaphores.begin(), frame.bandSemaphores.begin() + context.deviceGroup.deviceCount);
+            waitFlags.assign(waitSemaphores.size(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+        submitInfo = GetSubmitInfo(&frame.computeCmd, waitSemaphores, waitFlags, signalSemaphores);
+        groupSubmitInfo = GetLocalSubmitInfo((uint32_t)waitSemaphores.size(), (uint32_t)signalSemaphores.size());
+        if (splitFrame) {
+            submitInfo.pNext = &groupSubmitInfo;
+        }
+        vkResetFences(context.device, 1, &frame.computeFence);
+        VkCheck(vkQueueSubmit(context.queue, 1, &submitInfo, frame.computeFence));
+    }
 
     vkResetCommandBuffer(frame.graphicsCmd, 0);
 
@@ -370,6 +1035,11 @@ Result RenderFrame() {
         VkRenderPassBeginInfo passBeginInfo = GetRenderPassBeginInfo(context.renderPass, context.framebuffers[imageIndex], context.swapchain.extent, {1.0f, 0.0f, 0.0f, 1.0f});
         
         vkCmdBeginRenderPass(frame.graphicsCmd, &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        VkViewport viewport = {0.0f, 0.0f, (float)context.swapchain.extent.width, (float)context.swapchain.extent.height, 0.0f, 1.0f};
+        VkRect2D scissor = {{0, 0}, context.swapchain.extent};
+        vkCmdSetViewport(frame.graphicsCmd, 0, 1, &viewport);
+        vkCmdSetScissor(frame.graphicsCmd, 0, 1, &scissor);
+
         vkCmdBindPipeline(frame.graphicsCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, context.quadPipeline.pipeline);
         vkCmdBindDescriptorSets(frame.graphicsCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, context.quadPipeline.layout, 0, 1, &context.quadPipeline.set, 0, nullptr);
         vkCmdDraw(frame.graphicsCmd, 4, 1, 0, 0);
@@ -377,20 +1047,118 @@ Result RenderFrame() {
     }
     vkEndCommandBuffer(frame.graphicsCmd);
 
-    waitSemaphores = {frame.computeDoneSemaphore, frame.imageAvailableSemaphore};
+    waitSemaphores = {frame.imageAvailableSemaphore};
     signalSemaphores = {context.swapchain.submitReadySemaphores[imageIndex]};
-    waitFlags = {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    waitFlags = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    if (computeWork) {
+        waitSemaphores.push_back(frame.computeDoneSemaphore);
+        waitFlags.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    }
 
     submitInfo = GetSubmitInfo(&frame.graphicsCmd, waitSemaphores, waitFlags, signalSemaphores);
+    groupSubmitInfo = GetLocalSubmitInfo((uint32_t)waitSemaphores.size(), (uint32_t)signalSemaphores.size());
+    if (splitFrame) {
+        submitInfo.pNext = &groupSubmitInfo;
+    }
     VkCheck(vkQueueSubmit(context.queue, 1, &submitInfo, frame.renderFence));
 
     waitSemaphores = {context.swapchain.submitReadySemaphores[imageIndex]};
     VkPresentInfoKHR presentInfo = GetPresentInfo(waitSemaphores, &context.swapchain.swapchain, &imageIndex);
-    VkCheck(vkQueuePresentKHR(context.queue, &presentInfo));
+
+    uint64_t presentId = context.swapchain.presentId + 1;
+    VkPresentIdKHR presentIdInfo = {};
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &presentId;
+    if (context.presentWait) {
+        presentInfo.pNext = &presentIdInfo;
+        context.swapchain.presentId = presentId;
+    }
+
+    VkResult presented = vkQueuePresentKHR(context.queue, &presentInfo);
+    if (presented == VK_ERROR_OUT_OF_DATE_KHR || presented == VK_SUBOPTIMAL_KHR) {
+        context.swapchainDirty = true;
+    } else {
+        VkCheck(presented);
+    }
+
+    context.lastCamera = constants.camera;
+    context.frameCount++;
+    UpdateBindlessFrame(context.frameCount);
 
     return Success;
 }
 
+void ShutdownRenderContext() {
+    vkDeviceWaitIdle(context.device);
+
+    FlushDefragmentation();
+    context.defragmenter.movable.clear();
+
+    for (auto &frame : context.frames) {
+        FlushDeletionQueue(&frame.deletionQueue);
+        DestroyThreadCommandPools(&frame.threadPools);
+        DestroyPickSlot(&frame.pickSlot);
+
+        vkDestroyFence(context.device, frame.renderFence, nullptr);
+        vkDestroyFence(context.device, frame.computeFence, nullptr);
+        vkDestroySemaphore(context.device, frame.imageAvailableSemaphore, nullptr);
+        vkDestroySemaphore(context.device, frame.computeDoneSemaphore, nullptr);
+        for (auto semaphore : frame.bandSemaphores) {
+            vkDestroySemaphore(context.device, semaphore, nullptr);
+        }
+    }
+
+    DestroyImmediateSubmitter(&context.immediate);
+
+    if (context.settings.renderMode == RenderModeRaster) {
+        DestroyMeshPass(&context.meshPass);
+    }
+    DestroyPickPass(&context.pickPass);
+    DestroyTilePass(&context.tilePass);
+    DestroyWavefrontPass(&context.wavefrontPass);
+    DestroyLightingPass(&context.lightingPass);
+    DestroyOccupancyPyramid(&context.occupancyPyramid);
+    DestroyDistanceField(&context.distanceField);
+
+    DestroyBuffer(&context.voxelData);
+    DestroyImage(&context.voxelImage);
+    DestroyBuffer(&context.materialPalette);
+    DestroyDeviceGroup(&context.deviceGroup);
+    DestroyImage(&context.renderImage);
+    DestroyImage(&context.gbuffer);
+    vkDestroySampler(context.device, context.renderImageSampler, nullptr);
+
+    DestroyPipeline(&context.dispatchArgsPipeline);
+    DestroyPipeline(&context.shadePipeline);
+    DestroyPipeline(&context.quadPipeline);
+    DestroyPipeline(&context.computePipeline);
+
+    for (auto &retired : context.retiredSwapchains) {
+        retired.retireFrame = 0;
+    }
+    DestroyRetiredSwapchains();
+    for (auto framebuffer : context.framebuffers) {
+        vkDestroyFramebuffer(context.device, framebuffer, nullptr);
+    }
+    context.framebuffers.clear();
+    vkDestroyRenderPass(context.device, context.renderPass, nullptr);
+    SwapchainDestroy(&context.swapchain);
+
+    DestroyScene(&context.scene);
+    DestroyFrameConstantsRing(&context.frameConstants);
+    DestroyBindlessHeap(&context.bindless);
+    vkDestroyDescriptorPool(context.device, context.descriptorPool, nullptr);
+    vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+
+    DestroyMemoryPools(&context.memory);
+    vmaDestroyAllocator(context.allocator);
+
+    vkDestroyDevice(context.device, nullptr);
+    vkDestroySurfaceKHR(context.instance, context.surface, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+}
+
 Result GetResultFromVkResult(VkResult res) {
     switch (res) {
         case VK_SUCCESS: return Success;
@@ -7,11 +7,33 @@
 #include <vma/vk_mem_alloc.h>
 
 #include <array>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 #include "swapchain.h"
 #include "pipeline.h"
 #include "image.h"
 #include "buffer.h"
+#include "dispatch.h"
+#include "distancefield.h"
+#include "occupancy.h"
+#include "material.h"
+#include "lighting.h"
+#include "wavefront.h"
+#include "tiles.h"
+#include "camera.h"
+#include "commands.h"
+#include "bindless.h"
+#include "memory.h"
+#include "defragment.h"
+#include "deletion.h"
+#include "devicegroup.h"
+#include "device.h"
+#include "scene.h"
+#include "picking.h"
+#include "mesher.h"
 
 #ifdef VOXEL_DEBUG
 #define VkCheck(res) {\
@@ -40,51 +62,179 @@ struct FrameData {
     VkFence computeFence;
     VkSemaphore imageAvailableSemaphore;
     VkSemaphore computeDoneSemaphore;
+
+    std::vector<ThreadCommandPool> threadPools;
+
+    // Split-frame marching only: recorded for every device, one semaphore signalled per device.
+    VkCommandBuffer bandCmd;
+    std::array<VkSemaphore, MaxGroupDevices> bandSemaphores;
+
+    // Flushed once this frame's fences have signalled, before its slot records again.
+    DeletionQueue deletionQueue;
+
+    PickSlot pickSlot;
 };
 
 constexpr uint32_t MaxFramesInFlight = 2;
+constexpr uint64_t PresentWaitTimeout = 100000000; // 100 ms
+
+// A swapchain replaced on resize, destroyed once the presents that wait on its semaphores are done.
+struct RetiredSwapchain {
+    Swapchain swapchain;
+    std::vector<VkFramebuffer> framebuffers;
+    uint32_t retireFrame;
+};
+
+constexpr int32_t VoxelGridWidth = 64;
+constexpr int32_t VoxelGridHeight = 64;
+constexpr int32_t VoxelGridDepth = 64;
+
+constexpr int32_t MortonUpdateBlock = 8;
+
+enum MarchMode : uint32_t {
+    MarchFixedStep,
+    MarchSphereTrace,
+    MarchHierarchicalDDA,
+    // Workgroup-shared brick loads in voxel.comp; other kernels fall back to MarchHierarchicalDDA.
+    MarchBrickCooperative
+};
+
+enum VoxelLayout : uint32_t {
+    VoxelLayoutLinear,
+    VoxelLayoutMorton,
+    VoxelLayoutImage
+};
+
+enum RenderMode : uint32_t {
+    RenderModeMegakernel,
+    RenderModeWavefront,
+    // Greedy-meshed chunks are rasterised into the G-buffer in place of the primary march.
+    RenderModeRaster,
+    // Resolved by ScaleRenderSettings once the device is known.
+    RenderModeAuto
+};
+
+struct RenderSettings {
+    VoxelLayout voxelLayout;
+    RenderMode renderMode;
+    MarchMode marchMode;
+    // 0 leaves the limit to ScaleRenderSettings.
+    uint32_t maxBounces;
+    uint32_t rayBudget;
+    uint32_t maxRaysPerPixel;
+    // Multiplies the pixel footprint the DDA march compares against pyramid cells; 0 disables LOD.
+    float lodScale;
+    // Set when the scene has instances or a march mode or LOD scale was given. The raster pass draws
+    // none of them, so Auto keeps ray-marching.
+    bool needsRayMarch;
+    bool animateCamera;
+    bool lowLatency;
+    bool multiGpu;
+
+    // Device index or name fragment; VOXEL_DEVICE is used when empty.
+    std::string device;
+};
+
+struct ComputePushConstants {
+    MarchMode marchMode;
+    float lodScale;
+    uint64_t voxelAddress;
+};
+
+struct ShadePushConstants {
+    uint32_t frameIndex;
+    BindlessHandle palette;
+};
 
 struct RenderContext {
+    SDL_Window *window;
     VmaAllocator allocator;
+    MemoryTracker memory;
+    Defragmenter defragmenter;
 
     VkInstance instance;
     VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties deviceProperties;
+    DeviceCaps caps;
+    DeviceGroup deviceGroup;
+    bool bufferDeviceAddress;
+    bool presentWait;
     VkDevice device;
     VkQueue queue;
     VkSurfaceKHR surface;
     VkCommandPool commandPool;
+    ImmediateSubmitter immediate;
     VkRenderPass renderPass;
     VkDescriptorPool descriptorPool;
+    BindlessHeap bindless;
+
+    RenderSettings settings;
 
     Buffer voxelData;
+    Image voxelImage;
+    DistanceField distanceField;
+    OccupancyPyramid occupancyPyramid;
+    MarchMode marchMode;
+    Scene scene;
+
     Pipeline quadPipeline;
     Pipeline computePipeline;
+    Pipeline shadePipeline;
+    Pipeline dispatchArgsPipeline;
+    Buffer materialPalette;
+    BindlessHandle materialPaletteHandle;
+    Image gbuffer;
+    LightingPass lightingPass;
+    WavefrontPass wavefrontPass;
+    TilePass tilePass;
+    PickPass pickPass;
+    MeshPass meshPass;
+    std::vector<DirtyRegion> dirtyRegions;
+    uint32_t settledFrames;
     Image renderImage;
     VkSampler renderImageSampler;
 
     Swapchain swapchain;
     std::vector<VkFramebuffer> framebuffers;
+    std::vector<RetiredSwapchain> retiredSwapchains;
+    bool swapchainDirty;
 
+    // The low latency and split-frame modes run a single frame in flight.
     std::array<FrameData, MaxFramesInFlight> frames;
+    uint32_t framesInFlight;
     uint32_t frameCount;
+    uint32_t historyStartFrame;
+    Camera camera;
+    CameraSource cameraSource;
+    CameraConstants lastCamera;
+    FrameConstantsRing frameConstants;
 
     uint32_t queueFamily;
 };
 
-enum Result {
+enum Result : int {
     Success,
     ExtensionNotPresent,
     LayerNotPresent,
     UnsupportedPhysicalDevice,
     ErrorCreatingSurface,
     UnsupportedQueueFamily,
+    ErrorAllocatingMemory,
     Unknown
 };
 
-Result InitializeRenderContext(SDL_Window *window);
+Result InitializeRenderContext(SDL_Window *window, const RenderSettings &settings);
 Result RenderFrame();
+// Waits for the device to go idle and destroys everything InitializeRenderContext created.
+void ShutdownRenderContext();
+
+std::vector<std::string> GetVoxelShaderDefines();
+bool UseVoxelAddress();
+void BindVoxelStorage(VkDescriptorSet set, uint32_t binding);
 
-void UploadVoxelData(const std::vector<int> &data);
+// On ErrorAllocatingMemory the previous storage stays in use; an update may have meshed only some chunks.
+Result UploadVoxelData(const std::vector<int> &data);
+Result UpdateVoxelData(const std::vector<int> &data, glm::ivec3 min, glm::ivec3 max);
 
 Result GetResultFromVkResult(VkResult res);
 
@@ -0,0 +1,190 @@
+#include "defragment.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+void RegisterMovableBuffer(Buffer *buffer, VkBufferUsageFlags usage) {
+    for (auto &movable : context.defragmenter.movable) {
+        if (movable.buffer == buffer) {
+            movable.usage = usage;
+            return;
+        }
+    }
+
+    context.defragmenter.movable.push_back({buffer, usage});
+}
+
+void UnregisterMovableBuffer(Buffer *buffer) {
+    auto &movable = context.defragmenter.movable;
+    for (size_t i = 0; i < movable.size(); i++) {
+        if (movable[i].buffer == buffer) {
+            movable.erase(movable.begin() + i);
+            return;
+        }
+    }
+}
+
+static const MovableBuffer *FindMovableBuffer(VmaAllocation alloc) {
+    for (const auto &movable : context.defragmenter.movable) {
+        if (movable.buffer->buffer != VK_NULL_HANDLE && movable.buffer->alloc == alloc) {
+            return &movable;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool IsVoxelPoolFragmented() {
+    VmaDetailedStatistics stats = {};
+    vmaCalculatePoolStatistics(context.allocator, context.memory.voxelPool, &stats);
+
+    VkDeviceSize freeBytes = stats.statistics.blockBytes - stats.statistics.allocationBytes;
+    return freeBytes >= DefragmentMinFreeBytes && stats.unusedRangeCount > 1 && stats.unusedRangeSizeMax < freeBytes / 2;
+}
+
+static void BeginPass(Defragmenter *defragmenter) {
+    VkResult res = vmaBeginDefragmentationPass(context.allocator, defragmenter->defrag, &defragmenter->pass);
+    if (res == VK_SUCCESS) {
+        vmaEndDefragmentation(context.allocator, defragmenter->defrag, nullptr);
+        defragmenter->active = false;
+        return;
+    }
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+
+    for (uint32_t i = 0; i < defragmenter->pass.moveCount; i++) {
+        VmaDefragmentationMove &move = defragmenter->pass.pMoves[i];
+
+        const MovableBuffer *movable = FindMovableBuffer(move.srcAllocation);
+        if (!movable) {
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            continue;
+        }
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = movable->buffer->size;
+        bufferInfo.usage = movable->usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer = VK_NULL_HANDLE;
+        if (vkCreateBuffer(context.device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS ||
+            vmaBindBufferMemory(context.allocator, move.dstTmpAllocation, buffer) != VK_SUCCESS) {
+            vkDestroyBuffer(context.device, buffer, nullptr);
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            continue;
+        }
+
+        VkDeviceAddress address = 0;
+        if (movable->usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+            VkBufferDeviceAddressInfo addressInfo = {};
+            addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            addressInfo.buffer = buffer;
+            address = vkGetBufferDeviceAddress(context.device, &addressInfo);
+        }
+
+        VkBufferCopy copy = {};
+        copy.size = movable->buffer->size;
+        vkCmdCopyBuffer(cmd, movable->buffer->buffer, buffer, 1, &copy);
+
+        defragmenter->moves.push_back({movable->buffer, buffer, address});
+    }
+
+    defragmenter->ticket = EndSingleUseCmd(cmd);
+    defragmenter->passOpen = true;
+    defragmenter->patched = false;
+}
+
+// The new copies are complete, so frames recorded from here on read the moved buffers.
+static void PatchMoves(Defragmenter *defragmenter, uint32_t frameIndex) {
+    for (const auto &move : defragmenter->moves) {
+        defragmenter->retired.push_back(move.owner->buffer);
+        move.owner->buffer = move.buffer;
+        move.owner->address = move.address;
+    }
+    defragmenter->moves.clear();
+
+    defragmenter->patched = true;
+    defragmenter->retireFrame = frameIndex + MaxFramesInFlight;
+}
+
+static void EndPass(Defragmenter *defragmenter) {
+    for (auto buffer : defragmenter->retired) {
+        vkDestroyBuffer(context.device, buffer, nullptr);
+    }
+    defragmenter->retired.clear();
+
+    defragmenter->passOpen = false;
+    defragmenter->patched = false;
+
+    if (vmaEndDefragmentationPass(context.allocator, defragmenter->defrag, &defragmenter->pass) == VK_SUCCESS) {
+        VmaDefragmentationStats stats = {};
+        vmaEndDefragmentation(context.allocator, defragmenter->defrag, &stats);
+        defragmenter->active = false;
+
+        printf("Defragmented voxel pool: moved %u allocations (%llu KiB), freed %u blocks\n", stats.allocationsMoved,
+            (unsigned long long)(stats.bytesMoved >> 10), stats.deviceMemoryBlocksFreed);
+    }
+}
+
+void UpdateDefragmentation(uint32_t frameIndex) {
+    Defragmenter &defragmenter = context.defragmenter;
+
+    if (!defragmenter.active) {
+        if (defragmenter.movable.empty() || defragmenter.pendingFrees > 0 || frameIndex % MemoryBudgetInterval != 0 || !IsVoxelPoolFragmented()) {
+            return;
+        }
+
+        // Every pass allocates its destinations before the sources are released.
+        if (GetMemoryPressure() > MemoryPressureWarning) {
+            return;
+        }
+
+        VmaDefragmentationInfo info = {};
+        info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+        info.pool = context.memory.voxelPool;
+        info.maxBytesPerPass = DefragmentBytesPerPass;
+        info.maxAllocationsPerPass = DefragmentAllocationsPerPass;
+        if (vmaBeginDefragmentation(context.allocator, &info, &defragmenter.defrag) != VK_SUCCESS) {
+            return;
+        }
+
+        defragmenter.active = true;
+    }
+
+    if (!defragmenter.passOpen) {
+        BeginPass(&defragmenter);
+    } else if (!defragmenter.patched) {
+        if (IsTicketComplete(defragmenter.ticket)) {
+            PatchMoves(&defragmenter, frameIndex);
+        }
+    } else if (frameIndex >= defragmenter.retireFrame) {
+        EndPass(&defragmenter);
+    }
+}
+
+void FlushDefragmentation() {
+    Defragmenter &defragmenter = context.defragmenter;
+    if (!defragmenter.active) {
+        return;
+    }
+
+    if (defragmenter.passOpen) {
+        if (!defragmenter.patched) {
+            WaitForTicket(defragmenter.ticket);
+            PatchMoves(&defragmenter, context.frameCount);
+        }
+
+        for (auto &frame : context.frames) {
+            vkWaitForFences(context.device, 1, &frame.computeFence, VK_TRUE, UINT64_MAX);
+        }
+
+        EndPass(&defragmenter);
+    }
+
+    // The pool must not change under an unfinished defragmentation; it restarts on a later check.
+    if (defragmenter.active) {
+        vmaEndDefragmentation(context.allocator, defragmenter.defrag, nullptr);
+        defragmenter.active = false;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef DEFRAGMENT_H
+#define DEFRAGMENT_H
+
+#include <Volk/volk.h>
+#include <vma/vk_mem_alloc.h>
+
+#include <vector>
+
+#include "buffer.h"
+#include "commands.h"
+
+// The voxel pool is checked every MemoryBudgetInterval frames and compacted once this much of it is
+// free space split across more than one range.
+constexpr VkDeviceSize DefragmentMinFreeBytes = 16 << 20;
+constexpr VkDeviceSize DefragmentBytesPerPass = 8 << 20;
+constexpr uint32_t DefragmentAllocationsPerPass = 16;
+
+// A buffer whose handle and address may be swapped under it. Only buffers read through device
+// addresses are registered: descriptor sets of frames in flight cannot be rewritten.
+struct MovableBuffer {
+    Buffer *buffer;
+    VkBufferUsageFlags usage;
+};
+
+struct PendingMove {
+    Buffer *owner;
+    VkBuffer buffer;
+    VkDeviceAddress address;
+};
+
+// One VMA pass is in flight at a time: copies are submitted, handles are patched once the copies
+// complete, and the old buffers and their memory are released after every frame that read them retires.
+struct Defragmenter {
+    std::vector<MovableBuffer> movable;
+
+    VmaDefragmentationContext defrag;
+    VmaDefragmentationPassMoveInfo pass;
+    std::vector<PendingMove> moves;
+    std::vector<VkBuffer> retired;
+    SubmitTicket ticket;
+    uint32_t retireFrame;
+
+    bool active;
+    bool passOpen;
+    bool patched;
+
+    // Voxel pool frees still queued behind a submission; no defragmentation starts until they run.
+    uint32_t pendingFrees;
+};
+
+void RegisterMovableBuffer(Buffer *buffer, VkBufferUsageFlags usage);
+void UnregisterMovableBuffer(Buffer *buffer);
+
+void UpdateDefragmentation(uint32_t frameIndex);
+// Completes the open pass immediately, waiting on the copies and on frames in flight, and stops
+// defragmenting. Call before allocating, writing or freeing anything in the voxel pool.
+void FlushDefragmentation();
+
+#endif // DEFRAGMENT_H
@@ -0,0 +1,27 @@
+#include "deletion.h"
+
+#include "context.h"
+
+void PushDeleter(DeletionQueue *queue, Deleter deleter) {
+    queue->deleters.push_back(std::move(deleter));
+}
+
+void FlushDeletionQueue(DeletionQueue *queue) {
+    for (auto it = queue->deleters.rbegin(); it != queue->deleters.rend(); it++) {
+        (*it)();
+    }
+    queue->deleters.clear();
+}
+
+void DeferDestroy(Deleter deleter) {
+    uint32_t slot = (context.frameCount + context.framesInFlight - 1) % context.framesInFlight;
+    PushDeleter(&context.frames[slot].deletionQueue, std::move(deleter));
+}
+
+void DeferDestroyBuffer(const Buffer &buffer) {
+    DeferDestroy([buffer]() mutable { DestroyBuffer(&buffer); });
+}
+
+void DeferDestroyImage(const Image &image) {
+    DeferDestroy([image]() mutable { DestroyImage(&image); });
+}
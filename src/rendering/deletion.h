@@ -0,0 +1,26 @@
+#ifndef DELETION_H
+#define DELETION_H
+
+#include <functional>
+#include <vector>
+
+#include "buffer.h"
+#include "image.h"
+
+using Deleter = std::function<void()>;
+
+// Deleters run newest first, so objects pushed after their dependencies are destroyed before them.
+struct DeletionQueue {
+    std::vector<Deleter> deleters;
+};
+
+void PushDeleter(DeletionQueue *queue, Deleter deleter);
+void FlushDeletionQueue(DeletionQueue *queue);
+
+// Queues on the most recently submitted frame, whose fences cover every frame that can still use the
+// object. Main thread only; for objects read by immediate submits use ReleaseAfterSubmit instead.
+void DeferDestroy(Deleter deleter);
+void DeferDestroyBuffer(const Buffer &buffer);
+void DeferDestroyImage(const Image &image);
+
+#endif // DELETION_H
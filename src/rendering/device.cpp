@@ -0,0 +1,295 @@
+#include "device.h"
+
+#include "context.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+static const char *GetDeviceTypeName(VkPhysicalDeviceType type) {
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+        default: return "other";
+    }
+}
+
+static const char *GetRenderModeName(RenderMode mode) {
+    switch (mode) {
+        case RenderModeMegakernel: return "megakernel";
+        case RenderModeWavefront: return "wavefront";
+        case RenderModeRaster: return "raster";
+        default: return "auto";
+    }
+}
+
+static int64_t GetDeviceTypeScore(VkPhysicalDeviceType type) {
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 4000;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 2000;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 1000;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return 100;
+        default: return 0;
+    }
+}
+
+static bool HasExtension(const std::vector<VkExtensionProperties> &extensions, const char *name) {
+    for (const auto &extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Everything InitializeRenderContext enables unconditionally must be checked here.
+static const char *CheckRequirements(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceProperties &props, const std::vector<VkExtensionProperties> &extensions) {
+    if (props.apiVersion < VK_API_VERSION_1_3) {
+        return "needs Vulkan 1.3";
+    }
+
+    if (!HasExtension(extensions, VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+        return "no VK_KHR_swapchain";
+    }
+
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    if (!features12.runtimeDescriptorArray || !features12.descriptorBindingPartiallyBound ||
+        !features12.descriptorBindingStorageBufferUpdateAfterBind || !features12.descriptorBindingStorageImageUpdateAfterBind ||
+        !features12.descriptorBindingSampledImageUpdateAfterBind) {
+        return "no bindless descriptor indexing";
+    }
+
+    if (!features.features.shaderStorageBufferArrayDynamicIndexing || !features.features.shaderStorageImageArrayDynamicIndexing ||
+        !features.features.shaderSampledImageArrayDynamicIndexing) {
+        return "no dynamic indexing of descriptor arrays";
+    }
+
+    return nullptr;
+}
+
+static DeviceCandidate EvaluateDevice(VkPhysicalDevice physicalDevice) {
+    DeviceCandidate candidate = {};
+    candidate.physicalDevice = physicalDevice;
+    candidate.queueFamily = UINT32_MAX;
+
+    VkPhysicalDeviceVulkan11Properties props11 = {};
+    props11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_PROPERTIES;
+    VkPhysicalDeviceProperties2 props = {};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &props11;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+    candidate.properties = props.properties;
+
+    DeviceCaps &caps = candidate.caps;
+    caps.type = props.properties.deviceType;
+    caps.apiVersion = props.properties.apiVersion;
+    caps.maxWorkGroupInvocations = props.properties.limits.maxComputeWorkGroupInvocations;
+    caps.maxWorkGroupSizeX = props.properties.limits.maxComputeWorkGroupSize[0];
+
+    // Subgroup queries are only meaningful from Vulkan 1.1, which CheckRequirements implies.
+    if (props11.subgroupSupportedStages & VK_SHADER_STAGE_COMPUTE_BIT) {
+        caps.subgroupSize = props11.subgroupSize;
+        caps.subgroupBallot = (props11.subgroupSupportedOperations & VK_SUBGROUP_FEATURE_BALLOT_BIT) != 0;
+        caps.subgroupArithmetic = (props11.subgroupSupportedOperations & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT) != 0;
+    }
+
+    VkPhysicalDeviceMemoryProperties memory = {};
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memory);
+    for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+        if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            caps.deviceLocalBytes += memory.memoryHeaps[i].size;
+        }
+    }
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    for (uint32_t i = 0; i < familyCount; i++) {
+        if (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+            caps.computeQueueFamilies++;
+        }
+
+        VkBool32 present = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, context.surface, &present);
+
+        VkQueueFlags required = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+        if (candidate.queueFamily == UINT32_MAX && (families[i].queueFlags & required) == required && present) {
+            candidate.queueFamily = i;
+        }
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    candidate.rejection = CheckRequirements(physicalDevice, props.properties, extensions);
+    if (!candidate.rejection && candidate.queueFamily == UINT32_MAX) {
+        candidate.rejection = "no graphics and compute queue that can present";
+    }
+
+    if (candidate.rejection) {
+        candidate.score = -1;
+        return candidate;
+    }
+
+    // Device type dominates; memory, queues, subgroups and optional extensions break ties between
+    // devices of the same kind.
+    candidate.score = GetDeviceTypeScore(caps.type);
+    candidate.score += (int64_t)std::min<VkDeviceSize>(caps.deviceLocalBytes >> 26, 1024);
+    candidate.score += 50 * (int64_t)(caps.computeQueueFamilies - 1);
+    if (caps.subgroupBallot && caps.subgroupArithmetic) {
+        candidate.score += caps.subgroupSize;
+    }
+    if (HasExtension(extensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        candidate.score += 10;
+    }
+    if (HasExtension(extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        candidate.score += 10;
+    }
+
+    return candidate;
+}
+
+static bool MatchesOverride(const DeviceCandidate &candidate, size_t index, const std::string &override) {
+    char *end = nullptr;
+    unsigned long value = strtoul(override.c_str(), &end, 10);
+    if (end != override.c_str() && *end == '\0') {
+        return value == index;
+    }
+
+    std::string name = candidate.properties.deviceName;
+    std::string pattern = override;
+    for (auto &c : name) c = (char)tolower(c);
+    for (auto &c : pattern) c = (char)tolower(c);
+
+    return name.find(pattern) != std::string::npos;
+}
+
+Result SelectPhysicalDevice(const std::string &override, DeviceCandidate *selected) {
+    std::string pattern = override;
+    if (pattern.empty()) {
+        const char *env = getenv("VOXEL_DEVICE");
+        pattern = env ? env : "";
+    }
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(context.instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(context.instance, &deviceCount, devices.data());
+
+    std::vector<DeviceCandidate> candidates;
+    for (auto device : devices) {
+        candidates.push_back(EvaluateDevice(device));
+    }
+
+    int32_t best = -1;
+    int32_t forced = -1;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const DeviceCandidate &candidate = candidates[i];
+        if (candidate.rejection) {
+            printf("  [%zu] %s (%s): unusable, %s\n", i, candidate.properties.deviceName, GetDeviceTypeName(candidate.caps.type), candidate.rejection);
+            continue;
+        }
+
+        printf("  [%zu] %s (%s): score %lld, %llu MiB device-local, subgroup %u, %u compute families\n", i,
+            candidate.properties.deviceName, GetDeviceTypeName(candidate.caps.type), (long long)candidate.score,
+            (unsigned long long)(candidate.caps.deviceLocalBytes >> 20), candidate.caps.subgroupSize, candidate.caps.computeQueueFamilies);
+
+        if (best < 0 || candidate.score > candidates[best].score) {
+            best = (int32_t)i;
+        }
+        if (forced < 0 && !pattern.empty() && MatchesOverride(candidate, i, pattern)) {
+            forced = (int32_t)i;
+        }
+    }
+
+    if (!pattern.empty() && forced < 0) {
+        printf("No usable device matches '%s', falling back to the highest score\n", pattern.c_str());
+    }
+
+    int32_t chosen = forced >= 0 ? forced : best;
+    if (chosen < 0) {
+        return UnsupportedPhysicalDevice;
+    }
+
+    *selected = candidates[chosen];
+    printf("Using %s\n", selected->properties.deviceName);
+
+    return Success;
+}
+
+void ScaleRenderSettings(RenderSettings *settings, const DeviceCaps &caps) {
+    // Where compute is scarce, rasterising the meshed grid is cheaper than marching every pixel, unless
+    // the settings ask for something only the march draws.
+    if (settings->renderMode == RenderModeAuto) {
+        bool lowPower = caps.type == VK_PHYSICAL_DEVICE_TYPE_CPU || caps.type == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+        settings->renderMode = lowPower && !settings->needsRayMarch ? RenderModeRaster : RenderModeMegakernel;
+        printf("Render mode: %s for a %s device\n", GetRenderModeName(settings->renderMode), GetDeviceTypeName(caps.type));
+    }
+    if (settings->renderMode == RenderModeRaster && settings->needsRayMarch) {
+        printf("Raster mode draws only the grid; instances, --march and --lod are ignored\n");
+    }
+
+    // Only limits left to the device are lowered; values given on the command line are kept.
+    uint32_t rayBudget = DefaultRayBudget;
+    uint32_t maxRaysPerPixel = DefaultMaxRaysPerPixel;
+    uint32_t maxBounces = DefaultMaxBounces;
+    if (caps.type == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+        rayBudget = DefaultRayBudget / 16;
+        maxRaysPerPixel = 2;
+        maxBounces = 1;
+    } else if (caps.type == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) {
+        rayBudget = DefaultRayBudget / 2;
+    }
+
+    if (settings->rayBudget == 0) {
+        settings->rayBudget = rayBudget;
+        if (rayBudget != DefaultRayBudget) {
+            printf("Ray budget lowered to %u for a %s device\n", rayBudget, GetDeviceTypeName(caps.type));
+        }
+    }
+    if (settings->maxRaysPerPixel == 0) {
+        settings->maxRaysPerPixel = maxRaysPerPixel;
+    }
+    if (settings->maxBounces == 0) {
+        settings->maxBounces = maxBounces;
+    }
+}
+
+// The largest power of two up to 256 that fits the device's workgroup limits.
+uint32_t GetWavefrontGroupSize() {
+    uint32_t limit = std::min(context.caps.maxWorkGroupInvocations, context.caps.maxWorkGroupSizeX);
+    uint32_t size = 256;
+    while (size > 32 && size > limit) {
+        size /= 2;
+    }
+
+    return size;
+}
+
+// For kernels that include wavefront.glsl.
+std::vector<std::string> GetWavefrontShaderDefines() {
+    return {"WAVEFRONT_GROUP_SIZE=" + std::to_string(GetWavefrontGroupSize())};
+}
+
+// For kernels with a subgroup variant; only brick.glsl has one so far.
+std::vector<std::string> GetSubgroupShaderDefines() {
+    std::vector<std::string> defines;
+    if (context.caps.subgroupBallot && context.caps.subgroupArithmetic) {
+        defines.push_back("SUBGROUP_OPS");
+    }
+    return defines;
+}
@@ -0,0 +1,58 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <Volk/volk.h>
+
+#include <string>
+#include <vector>
+
+struct RenderSettings;
+
+// Used for limits the settings leave at 0, before ScaleRenderSettings lowers them for slower devices.
+// Counted in rays; each lighting sample traces two.
+constexpr uint32_t DefaultRayBudget = 1 << 20;
+constexpr uint32_t DefaultMaxRaysPerPixel = 8;
+constexpr uint32_t DefaultMaxBounces = 3;
+
+// What the selector learned about the chosen device. Kernel variants and render defaults follow it.
+struct DeviceCaps {
+    VkPhysicalDeviceType type;
+    uint32_t apiVersion;
+
+    uint32_t subgroupSize;
+    bool subgroupArithmetic;
+    bool subgroupBallot;
+
+    uint32_t maxWorkGroupInvocations;
+    uint32_t maxWorkGroupSizeX;
+    uint32_t computeQueueFamilies;
+    VkDeviceSize deviceLocalBytes;
+};
+
+struct DeviceCandidate {
+    VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties properties;
+    DeviceCaps caps;
+    uint32_t queueFamily;
+
+    // Negative when the device can't run the renderer; rejection says why.
+    int64_t score;
+    const char *rejection;
+};
+
+enum Result : int;
+
+// Scores every physical device and picks the best usable one. override (an index into the device
+// list or part of a device name) takes priority when it matches a usable device; VOXEL_DEVICE is
+// read when no override is given.
+Result SelectPhysicalDevice(const std::string &override, DeviceCandidate *selected);
+
+// Fills in the ray limits left at 0, lowered on integrated and software devices so they stay
+// interactive, and resolves RenderModeAuto for the device.
+void ScaleRenderSettings(RenderSettings *settings, const DeviceCaps &caps);
+
+uint32_t GetWavefrontGroupSize();
+std::vector<std::string> GetWavefrontShaderDefines();
+std::vector<std::string> GetSubgroupShaderDefines();
+
+#endif // DEVICE_H
@@ -0,0 +1,126 @@
+#include "devicegroup.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+static const std::array<uint32_t, 2 * MaxGroupDevices> LocalDeviceIndices = {};
+static const uint32_t LocalDeviceMask = 1;
+
+void FindDeviceGroup(VkPhysicalDevice physicalDevice, DeviceGroup *group) {
+    group->physicalDevices = {physicalDevice};
+    group->deviceCount = 1;
+
+    uint32_t groupCount = 0;
+    vkEnumeratePhysicalDeviceGroups(context.instance, &groupCount, nullptr);
+    std::vector<VkPhysicalDeviceGroupProperties> groups(groupCount);
+    for (auto &props : groups) {
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GROUP_PROPERTIES;
+    }
+    vkEnumeratePhysicalDeviceGroups(context.instance, &groupCount, groups.data());
+
+    for (const auto &props : groups) {
+        bool contains = false;
+        for (uint32_t i = 0; i < props.physicalDeviceCount; i++) {
+            contains |= props.physicalDevices[i] == physicalDevice;
+        }
+
+        if (!contains || props.physicalDeviceCount < 2) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < props.physicalDeviceCount && group->deviceCount < MaxGroupDevices; i++) {
+            if (props.physicalDevices[i] != physicalDevice) {
+                group->physicalDevices[group->deviceCount++] = props.physicalDevices[i];
+            }
+        }
+        return;
+    }
+}
+
+uint32_t GetAllDevicesMask(const DeviceGroup &group) {
+    return (1u << group.deviceCount) - 1;
+}
+
+Result ResizeDeviceGroup(DeviceGroup *group, const Image &gbuffer) {
+    uint32_t tileRows = GetGroupCount(gbuffer.height, TileSize);
+    uint32_t bandTiles = GetGroupCount(tileRows, group->deviceCount);
+    for (uint32_t i = 0; i <= group->deviceCount; i++) {
+        group->bandRows[i] = glm::min(i * bandTiles * TileSize, gbuffer.height);
+    }
+
+    if (group->deviceCount < 2) {
+        return Success;
+    }
+
+    vkDestroyImage(context.device, group->gbufferPeer, nullptr);
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags = VK_IMAGE_CREATE_ALIAS_BIT;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = gbuffer.format;
+    imageInfo.extent = {gbuffer.width, gbuffer.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | PeerImageUsage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+    VkCheck(vkCreateImage(context.device, &imageInfo, nullptr, &group->gbufferPeer));
+
+    VkBindImageMemoryDeviceGroupInfo bindInfo = {};
+    bindInfo.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_DEVICE_GROUP_INFO;
+    bindInfo.deviceIndexCount = group->deviceCount;
+    bindInfo.pDeviceIndices = LocalDeviceIndices.data();
+    VkCheck(vmaBindImageMemory2(context.allocator, gbuffer.alloc, 0, group->gbufferPeer, &bindInfo));
+
+    // Peers only ever copy into the alias; the layout change is done where the memory lives.
+    Image peer = gbuffer;
+    peer.image = group->gbufferPeer;
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+    vkCmdSetDeviceMask(cmd, LocalDeviceMask);
+    SetImageLayout(cmd, peer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    vkCmdSetDeviceMask(cmd, GetAllDevicesMask(*group));
+    EndSingleUseCmd(cmd);
+
+    return Success;
+}
+
+void DestroyDeviceGroup(DeviceGroup *group) {
+    vkDestroyImage(context.device, group->gbufferPeer, nullptr);
+    group->gbufferPeer = VK_NULL_HANDLE;
+}
+
+void CopyBandToPeer(VkCommandBuffer cmd, const DeviceGroup &group, const Image &gbuffer, uint32_t device) {
+    uint32_t rowMin = group.bandRows[device];
+    uint32_t rowMax = group.bandRows[device + 1];
+    if (rowMin >= rowMax) {
+        return;
+    }
+
+    GlobalBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkImageCopy region = {};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.srcOffset = {0, (int32_t)rowMin, 0};
+    region.dstSubresource = region.srcSubresource;
+    region.dstOffset = region.srcOffset;
+    region.extent = {gbuffer.width, rowMax - rowMin, 1};
+    vkCmdCopyImage(cmd, gbuffer.image, VK_IMAGE_LAYOUT_GENERAL, group.gbufferPeer, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+}
+
+VkDeviceGroupSubmitInfo GetLocalSubmitInfo(uint32_t waitCount, uint32_t signalCount) {
+    VkDeviceGroupSubmitInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO;
+    info.pNext = nullptr;
+    info.waitSemaphoreCount = waitCount;
+    info.pWaitSemaphoreDeviceIndices = LocalDeviceIndices.data();
+    info.commandBufferCount = 1;
+    info.pCommandBufferDeviceMasks = &LocalDeviceMask;
+    info.signalSemaphoreCount = signalCount;
+    info.pSignalSemaphoreDeviceIndices = LocalDeviceIndices.data();
+
+    return info;
+}
@@ -0,0 +1,44 @@
+#ifndef DEVICEGROUP_H
+#define DEVICEGROUP_H
+
+#include <Volk/volk.h>
+
+#include <array>
+
+#include "image.h"
+
+constexpr uint32_t MaxGroupDevices = 4;
+
+// The gbuffer and its peer alias must be created identically for their contents to match.
+constexpr VkImageUsageFlags PeerImageUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+// Split-frame ray marching over a device group. Device-local allocations are replicated per
+// physical device, so every device marches its own band from its own copy of the voxel data and
+// copies the band into device 0's gbuffer, where lighting, shading and present run.
+struct DeviceGroup {
+    std::array<VkPhysicalDevice, MaxGroupDevices> physicalDevices;
+    uint32_t deviceCount;
+
+    // Band i covers rows [bandRows[i], bandRows[i + 1]), aligned to whole tiles.
+    std::array<uint32_t, MaxGroupDevices + 1> bandRows;
+
+    // Bound to device 0's instance of the gbuffer memory on every device; target of the band copies.
+    VkImage gbufferPeer;
+};
+
+enum Result : int;
+
+// Fills group with the device group containing physicalDevice, reordered so physicalDevice is device
+// index 0. deviceCount stays 1 when it has no peers.
+void FindDeviceGroup(VkPhysicalDevice physicalDevice, DeviceGroup *group);
+uint32_t GetAllDevicesMask(const DeviceGroup &group);
+
+Result ResizeDeviceGroup(DeviceGroup *group, const Image &gbuffer);
+void DestroyDeviceGroup(DeviceGroup *group);
+
+void CopyBandToPeer(VkCommandBuffer cmd, const DeviceGroup &group, const Image &gbuffer, uint32_t device);
+
+// For submissions that run, wait and signal on device 0 only.
+VkDeviceGroupSubmitInfo GetLocalSubmitInfo(uint32_t waitCount, uint32_t signalCount);
+
+#endif // DEVICEGROUP_H
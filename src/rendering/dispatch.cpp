@@ -0,0 +1,71 @@
+#include "dispatch.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+struct DispatchArgsPushConstants {
+    uint32_t slotCount;
+    uint32_t groupSize;
+    uint32_t maxGroupsX;
+};
+
+Result CreateDispatchArgsPipeline(Pipeline *pipeline) {
+    *pipeline = CreateComputePipeline("../../res/shaders/dispatchargs.comp");
+
+    return Success;
+}
+
+IndirectDispatch CreateIndirectDispatch(uint32_t slotCount, uint32_t payloadSize) {
+    IndirectDispatch dispatch = {};
+    dispatch.slotCount = slotCount;
+    dispatch.set = AllocateDescriptorSet(context.dispatchArgsPipeline);
+    ResizeIndirectDispatch(&dispatch, payloadSize);
+
+    return dispatch;
+}
+
+void DestroyIndirectDispatch(IndirectDispatch *dispatch) {
+    DestroyBuffer(&dispatch->buffer);
+    dispatch->set = VK_NULL_HANDLE;
+}
+
+void ResizeIndirectDispatch(IndirectDispatch *dispatch, uint32_t payloadSize) {
+    DestroyBuffer(&dispatch->buffer);
+    dispatch->buffer = CreateBuffer(IndirectSlotSize * dispatch->slotCount + payloadSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+    BindStorageBuffer(dispatch->set, 0, dispatch->buffer);
+}
+
+void ResetIndirectCounts(VkCommandBuffer cmd, IndirectDispatch *dispatch) {
+    vkCmdFillBuffer(cmd, dispatch->buffer.buffer, 0, IndirectSlotSize * dispatch->slotCount, 0);
+    BufferBarrier(cmd, dispatch->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void SetIndirectCount(VkCommandBuffer cmd, IndirectDispatch *dispatch, uint32_t slot, uint32_t count) {
+    vkCmdUpdateBuffer(cmd, dispatch->buffer.buffer, IndirectSlotSize * slot + 3 * sizeof(uint32_t), sizeof(count), &count);
+    BufferBarrier(cmd, dispatch->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void ResolveIndirectArgs(VkCommandBuffer cmd, IndirectDispatch *dispatch, uint32_t groupSize) {
+    DispatchArgsPushConstants push = {};
+    push.slotCount = dispatch->slotCount;
+    push.groupSize = groupSize;
+    push.maxGroupsX = context.deviceProperties.limits.maxComputeWorkGroupCount[0];
+
+    BufferBarrier(cmd, dispatch->buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, context.dispatchArgsPipeline.pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, context.dispatchArgsPipeline.layout, 0, 1, &dispatch->set, 0, nullptr);
+    vkCmdPushConstants(cmd, context.dispatchArgsPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, GetGroupCount(dispatch->slotCount, 64), 1, 1);
+
+    BufferBarrier(cmd, dispatch->buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+}
+
+void DispatchIndirect(VkCommandBuffer cmd, const IndirectDispatch &dispatch, uint32_t slot) {
+    vkCmdDispatchIndirect(cmd, dispatch.buffer.buffer, IndirectSlotSize * slot);
+}
+
+uint32_t GetGroupCount(uint32_t count, uint32_t groupSize) {
+    return (count + groupSize - 1) / groupSize;
+}
@@ -0,0 +1,34 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <Volk/volk.h>
+
+#include "buffer.h"
+#include "pipeline.h"
+
+// Slots of {groupsX, groupsY, groupsZ, count} at the start of the buffer, optionally followed
+// by a payload (e.g. a compacted item list) that the producing pass appends to.
+struct IndirectDispatch {
+    Buffer buffer;
+    VkDescriptorSet set;
+    uint32_t slotCount;
+};
+
+constexpr uint32_t IndirectSlotSize = 4 * sizeof(uint32_t);
+
+enum Result : int;
+
+Result CreateDispatchArgsPipeline(Pipeline *pipeline);
+
+IndirectDispatch CreateIndirectDispatch(uint32_t slotCount, uint32_t payloadSize);
+void DestroyIndirectDispatch(IndirectDispatch *dispatch);
+// Replaces the buffer, keeping the descriptor set. The old buffer must no longer be in use.
+void ResizeIndirectDispatch(IndirectDispatch *dispatch, uint32_t payloadSize);
+void ResetIndirectCounts(VkCommandBuffer cmd, IndirectDispatch *dispatch);
+void SetIndirectCount(VkCommandBuffer cmd, IndirectDispatch *dispatch, uint32_t slot, uint32_t count);
+void ResolveIndirectArgs(VkCommandBuffer cmd, IndirectDispatch *dispatch, uint32_t groupSize);
+void DispatchIndirect(VkCommandBuffer cmd, const IndirectDispatch &dispatch, uint32_t slot);
+
+uint32_t GetGroupCount(uint32_t count, uint32_t groupSize);
+
+#endif // DISPATCH_H
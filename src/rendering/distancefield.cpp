@@ -0,0 +1,100 @@
+#include "distancefield.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+enum DistanceFieldPass {
+    DistanceFieldSeed,
+    DistanceFieldFlood,
+    DistanceFieldResolve
+};
+
+struct DistanceFieldPushConstants {
+    glm::ivec4 regionMin;
+    glm::ivec4 regionMax;
+    int32_t pass;
+    int32_t stepSize;
+    int32_t readHalf;
+    int32_t maxDistance;
+    uint64_t voxelAddress;
+};
+
+static void DispatchRegion(VkCommandBuffer cmd, DistanceField *field, DistanceFieldPushConstants &push, glm::ivec3 min, glm::ivec3 max) {
+    push.regionMin = glm::ivec4(min, 0);
+    push.regionMax = glm::ivec4(max, 0);
+
+    glm::ivec3 extent = max - min;
+    vkCmdPushConstants(cmd, field->pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, (extent.x + 3) / 4, (extent.y + 3) / 4, (extent.z + 3) / 4);
+}
+
+Result CreateDistanceField(DistanceField *field) {
+    uint32_t cellCount = VoxelGridWidth * VoxelGridHeight * VoxelGridDepth;
+
+    field->distances = CreateBuffer(sizeof(int32_t) * cellCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryFields);
+    field->seeds = CreateBuffer(2 * sizeof(uint32_t) * cellCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryFields);
+    if (field->distances.buffer == VK_NULL_HANDLE || field->seeds.buffer == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+
+    field->pipeline = CreateComputePipeline("../../res/shaders/jfa.comp", GetVoxelShaderDefines());
+
+    BindStorageBuffer(field->pipeline.set, 1, field->seeds);
+    BindStorageBuffer(field->pipeline.set, 2, field->distances);
+
+    return Success;
+}
+
+void DestroyDistanceField(DistanceField *field) {
+    DestroyPipeline(&field->pipeline);
+    DestroyBuffer(&field->seeds);
+    DestroyBuffer(&field->distances);
+}
+
+void BuildDistanceField(VkCommandBuffer cmd, DistanceField *field, glm::ivec3 dirtyMin, glm::ivec3 dirtyMax) {
+    glm::ivec3 gridMax(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth);
+
+    // Cells within the distance cap of a change can see a new nearest seed, and that seed lies
+    // at most one more cap away, so flooding twice the cap around the change is sufficient.
+    glm::ivec3 floodMin = glm::max(dirtyMin - 2 * DistanceFieldMaxDistance, glm::ivec3(0));
+    glm::ivec3 floodMax = glm::min(dirtyMax + 2 * DistanceFieldMaxDistance, gridMax);
+    glm::ivec3 resolveMin = glm::max(dirtyMin - DistanceFieldMaxDistance, glm::ivec3(0));
+    glm::ivec3 resolveMax = glm::min(dirtyMax + DistanceFieldMaxDistance, gridMax);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, field->pipeline.pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, field->pipeline.layout, 0, 1, &field->pipeline.set, 0, nullptr);
+
+    DistanceFieldPushConstants push = {};
+    push.maxDistance = DistanceFieldMaxDistance;
+    push.voxelAddress = context.voxelData.address;
+
+    push.pass = DistanceFieldSeed;
+    push.readHalf = 1;
+    DispatchRegion(cmd, field, push, floodMin, floodMax);
+
+    int32_t readHalf = 0;
+    std::vector<int32_t> steps;
+    for (int32_t step = DistanceFieldMaxDistance; step >= 1; step /= 2) {
+        steps.push_back(step);
+    }
+    steps.push_back(1);
+
+    for (int32_t step : steps) {
+        BufferBarrier(cmd, field->seeds, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        push.pass = DistanceFieldFlood;
+        push.stepSize = step;
+        push.readHalf = readHalf;
+        DispatchRegion(cmd, field, push, floodMin, floodMax);
+
+        readHalf = 1 - readHalf;
+    }
+
+    BufferBarrier(cmd, field->seeds, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    push.pass = DistanceFieldResolve;
+    push.readHalf = readHalf;
+    DispatchRegion(cmd, field, push, resolveMin, resolveMax);
+
+    BufferBarrier(cmd, field->distances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
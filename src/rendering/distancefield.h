@@ -0,0 +1,24 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include "buffer.h"
+#include "pipeline.h"
+
+constexpr int32_t DistanceFieldMaxDistance = 8;
+
+struct DistanceField {
+    Buffer distances;
+    Buffer seeds;
+    Pipeline pipeline;
+};
+
+enum Result : int;
+
+Result CreateDistanceField(DistanceField *field);
+void DestroyDistanceField(DistanceField *field);
+void BuildDistanceField(VkCommandBuffer cmd, DistanceField *field, glm::ivec3 dirtyMin, glm::ivec3 dirtyMax);
+
+#endif // DISTANCEFIELD_H
@@ -3,16 +3,16 @@
 #include "context.h"
 #include "vkutil.h"
 
-Image CreateImage(VkFormat format, VkImageUsageFlags usage, uint32_t width, uint32_t height) {
+Image CreateImage(VkFormat format, VkImageUsageFlags usage, uint32_t width, uint32_t height, uint32_t depth, MemoryCategory category, VkImageCreateFlags flags) {
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.pNext = nullptr;
-    imageInfo.flags = 0;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.flags = flags;
+    imageInfo.imageType = depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
     imageInfo.format = format;
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
-    imageInfo.extent.depth = 1;
+    imageInfo.extent.depth = depth;
     imageInfo.mipLevels = 1;
     imageInfo.arrayLayers = 1;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -25,19 +25,76 @@ Image CreateImage(VkFormat format, VkImageUsageFlags usage, uint32_t width, uint
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.pool = GetImagePool(category);
 
     Image image = {};
+    image.format = format;
     image.width = width;
     image.height = height;
+    image.depth = depth;
 
-    vmaCreateImage(context.allocator, &imageInfo, &allocInfo, &image.image, &image.alloc, nullptr);
+    VkResult res = vmaCreateImage(context.allocator, &imageInfo, &allocInfo, &image.image, &image.alloc, nullptr);
+    if (res != VK_SUCCESS && allocInfo.pool != VK_NULL_HANDLE) {
+        allocInfo.pool = VK_NULL_HANDLE;
+        res = vmaCreateImage(context.allocator, &imageInfo, &allocInfo, &image.image, &image.alloc, nullptr);
+    }
+    if (res != VK_SUCCESS) {
+        printf("Failed to allocate %ux%ux%u %s image: %s\n", width, height, depth, GetMemoryCategoryName(category), string_VkResult(res));
+        return {};
+    }
+    TrackAllocation(image.alloc, category);
 
-    VkImageViewCreateInfo viewInfo = GetImageViewCreateInfo(image.image, format, VK_IMAGE_ASPECT_COLOR_BIT);
+    VkImageViewType viewType = depth > 1 ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
+    VkImageAspectFlags aspect = (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    VkImageViewCreateInfo viewInfo = GetImageViewCreateInfo(image.image, format, aspect, viewType);
     vkCreateImageView(context.device, &viewInfo, nullptr, &image.view);
 
     return image;
 }
 
+void DestroyImage(Image *image) {
+    if (image->image == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDestroyImageView(context.device, image->view, nullptr);
+    UntrackAllocation(image->alloc);
+    vmaDestroyImage(context.allocator, image->image, image->alloc);
+    *image = {};
+}
+
+Result CopyToImage(Image *image, uint8_t *data, uint32_t dataCount, const std::vector<VkBufferImageCopy> &regions, VkImageLayout srcLayout, VkImageLayout dstLayout) {
+    Buffer staging = CreateBuffer(dataCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategoryStaging);
+    if (staging.buffer == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+
+    uint8_t *stagingData;
+    vmaMapMemory(context.allocator, staging.alloc, (void **)&stagingData);
+    std::memcpy(stagingData, data, dataCount);
+    vmaUnmapMemory(context.allocator, staging.alloc);
+    vmaFlushAllocation(context.allocator, staging.alloc, 0, VK_WHOLE_SIZE);
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+    SetImageLayout(cmd, *image, srcLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdCopyBufferToImage(cmd, staging.buffer, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+    SetImageLayout(cmd, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, dstLayout);
+    ReleaseAfterSubmit(staging);
+    EndSingleUseCmd(cmd);
+
+    return Success;
+}
+
+void BindStorageImage(VkDescriptorSet set, uint32_t binding, const Image &image) {
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfo.imageView = image.view;
+    imageInfo.sampler = VK_NULL_HANDLE;
+
+    VkWriteDescriptorSet write = GetWriteDescriptorSet(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, nullptr, &imageInfo);
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+}
+
 void SetImageLayout(VkCommandBuffer cmd, Image image, VkImageLayout srcLayout, VkImageLayout dstLayout) {
     VkImageSubresourceRange subresourceRange = {};
     subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -84,6 +141,10 @@ void SetImageLayout(VkCommandBuffer cmd, Image image, VkImageLayout srcLayout, V
     case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
         barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
         break;
+
+    case VK_IMAGE_LAYOUT_GENERAL:
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        break;
     default:
         break;
     }
@@ -113,6 +174,10 @@ void SetImageLayout(VkCommandBuffer cmd, Image image, VkImageLayout srcLayout, V
         }
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
         break;
+
+    case VK_IMAGE_LAYOUT_GENERAL:
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        break;
     default:
         break;
     }
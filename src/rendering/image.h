@@ -5,16 +5,29 @@
 
 #include <vma/vk_mem_alloc.h>
 
+#include <vector>
+
+#include "memory.h"
+
 struct Image {
     VkImage image;
     VkImageView view;
     VmaAllocation alloc;
 
     VkFormat format;
-    uint32_t width, height;
+    uint32_t width, height, depth;
 };
 
-Image CreateImage(VkFormat format, VkImageUsageFlags usage, uint32_t width, uint32_t height);
+// Returns an empty image when the allocation fails.
+Image CreateImage(VkFormat format, VkImageUsageFlags usage, uint32_t width, uint32_t height, uint32_t depth = 1, MemoryCategory category = MemoryCategoryImages, VkImageCreateFlags flags = 0);
+void DestroyImage(Image *image);
+
+enum Result : int;
+
+// Nothing is recorded when the staging allocation fails, so the image keeps its contents and layout.
+Result CopyToImage(Image *image, uint8_t *data, uint32_t dataCount, const std::vector<VkBufferImageCopy> &regions, VkImageLayout srcLayout, VkImageLayout dstLayout);
+
+void BindStorageImage(VkDescriptorSet set, uint32_t binding, const Image &image);
 
 void SetImageLayout(VkCommandBuffer cmd, Image image, VkImageLayout srcLayout, VkImageLayout dstLayout);
 
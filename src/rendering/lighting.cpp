@@ -0,0 +1,75 @@
+#include "lighting.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+constexpr uint32_t LightingGroupSize = 64;
+
+Result CreateLightingPass(LightingPass *pass, uint32_t width, uint32_t height) {
+    pass->compactPipeline = CreateComputePipeline("../../res/shaders/compact.comp");
+    pass->lightingPipeline = CreateComputePipeline("../../res/shaders/lighting.comp", GetVoxelShaderDefines());
+
+    pass->hitQueue = CreateIndirectDispatch(1, 0);
+
+    BindStorageBuffer(pass->lightingPipeline.set, 3, context.distanceField.distances);
+    BindStorageBuffer(pass->lightingPipeline.set, 4, context.occupancyPyramid.cells);
+    BindFrameConstants(pass->lightingPipeline.set, 7, context.frameConstants);
+
+    return ResizeLightingPass(pass, width, height);
+}
+
+Result ResizeLightingPass(LightingPass *pass, uint32_t width, uint32_t height) {
+    ResizeIndirectDispatch(&pass->hitQueue, sizeof(uint32_t) * width * height);
+    for (auto &image : pass->history) {
+        DestroyImage(&image);
+        image = CreateImage(VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, width, height);
+    }
+
+    BindStorageImage(pass->compactPipeline.set, 0, context.gbuffer);
+    BindStorageBuffer(pass->compactPipeline.set, 1, pass->hitQueue.buffer);
+    BindStorageImage(pass->compactPipeline.set, 2, pass->history[0]);
+    BindStorageImage(pass->compactPipeline.set, 3, pass->history[1]);
+
+    BindStorageImage(pass->lightingPipeline.set, 0, context.gbuffer);
+    BindStorageBuffer(pass->lightingPipeline.set, 1, pass->hitQueue.buffer);
+    BindStorageImage(pass->lightingPipeline.set, 5, pass->history[0]);
+    BindStorageImage(pass->lightingPipeline.set, 6, pass->history[1]);
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+    for (auto &image : pass->history) {
+        SetImageLayout(cmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    EndSingleUseCmd(cmd);
+
+    return Success;
+}
+
+void DestroyLightingPass(LightingPass *pass) {
+    for (auto &image : pass->history) {
+        DestroyImage(&image);
+    }
+    DestroyIndirectDispatch(&pass->hitQueue);
+
+    DestroyPipeline(&pass->lightingPipeline);
+    DestroyPipeline(&pass->compactPipeline);
+}
+
+void RecordLightingPass(VkCommandBuffer cmd, LightingPass *pass, const LightingPushConstants &push) {
+    ResetIndirectCounts(cmd, &pass->hitQueue);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pass->compactPipeline.pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pass->compactPipeline.layout, 0, 1, &pass->compactPipeline.set, 0, nullptr);
+    vkCmdPushConstants(cmd, pass->compactPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push.frameIndex), &push.frameIndex);
+    vkCmdDispatch(cmd, GetGroupCount(context.gbuffer.width, 16), GetGroupCount(context.gbuffer.height, 16), 1);
+
+    ResolveIndirectArgs(cmd, &pass->hitQueue, LightingGroupSize);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pass->lightingPipeline.pipeline);
+    BindDescriptorSets(cmd, pass->lightingPipeline);
+    vkCmdPushConstants(cmd, pass->lightingPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    DispatchIndirect(cmd, pass->hitQueue, 0);
+
+    for (auto &image : pass->history) {
+        SetImageLayout(cmd, image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <Volk/volk.h>
+
+#include <array>
+
+#include "buffer.h"
+#include "dispatch.h"
+#include "image.h"
+#include "pipeline.h"
+
+// Frames of temporal accumulation after the last change before a static view stops re-rendering.
+constexpr uint32_t LightingSettleFrames = 64;
+
+struct LightingPass {
+    Pipeline compactPipeline;
+    Pipeline lightingPipeline;
+
+    IndirectDispatch hitQueue;
+    std::array<Image, 2> history;
+};
+
+struct LightingPushConstants {
+    uint32_t frameIndex;
+    uint32_t rayBudget;
+    uint32_t maxRaysPerPixel;
+    int32_t marchMode;
+    int32_t historyValid;
+    uint64_t voxelAddress;
+};
+
+enum Result : int;
+
+Result CreateLightingPass(LightingPass *pass, uint32_t width, uint32_t height);
+// Recreates the screen-sized resources and rebinds context.gbuffer. Frames using them must have retired.
+Result ResizeLightingPass(LightingPass *pass, uint32_t width, uint32_t height);
+void DestroyLightingPass(LightingPass *pass);
+void RecordLightingPass(VkCommandBuffer cmd, LightingPass *pass, const LightingPushConstants &push);
+
+#endif // LIGHTING_H
@@ -0,0 +1,41 @@
+#include "material.h"
+
+#include "context.h"
+
+Material CreateMaterial(glm::vec3 albedo, float roughness, glm::vec3 emission) {
+    Material material = {};
+    material.albedo = glm::vec4(albedo, 1.0f);
+    material.emission = glm::vec4(emission, 0.0f);
+    material.roughness = roughness;
+
+    return material;
+}
+
+Result UploadMaterialPalette(const std::vector<Material> &materials) {
+    // Voxel value 0 is empty space, so slot 0 is never shaded but keeps indices aligned.
+    std::vector<Material> palette = materials;
+    if (palette.empty()) {
+        palette.push_back(CreateMaterial(glm::vec3(1.0f), 1.0f));
+    }
+
+    // The old palette stays bound until the new one is fully uploaded.
+    Buffer materialPalette = CreateBuffer(sizeof(Material) * palette.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    if (materialPalette.buffer == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+    if (CopyToBuffer(&materialPalette, (uint8_t*)palette.data(), sizeof(Material) * palette.size()) != Success) {
+        DestroyBuffer(&materialPalette);
+        return ErrorAllocatingMemory;
+    }
+
+    // Frames in flight may still read the old palette through its bindless handle.
+    DeferDestroyBuffer(context.materialPalette);
+    context.materialPalette = materialPalette;
+
+    ReleaseBindlessBuffer(context.materialPaletteHandle);
+    context.materialPaletteHandle = RegisterBindlessBuffer(context.materialPalette);
+
+    context.settledFrames = 0;
+
+    return Success;
+}
@@ -0,0 +1,22 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct Material {
+    glm::vec4 albedo;
+    glm::vec4 emission;
+    float roughness;
+    float padding[3];
+};
+
+Material CreateMaterial(glm::vec3 albedo, float roughness, glm::vec3 emission = glm::vec3(0.0f));
+
+enum Result : int;
+
+Result UploadMaterialPalette(const std::vector<Material> &materials);
+
+#endif // MATERIAL_H
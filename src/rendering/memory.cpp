@@ -0,0 +1,167 @@
+#include "memory.h"
+
+#include "context.h"
+
+#include <cstdio>
+
+Result CreateMemoryPools(MemoryTracker *memory) {
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = 1 << 16;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (context.bufferDeviceAddress) {
+        bufferInfo.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    }
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    VmaPoolCreateInfo poolInfo = {};
+    VkCheck(vmaFindMemoryTypeIndexForBufferInfo(context.allocator, &bufferInfo, &allocInfo, &poolInfo.memoryTypeIndex));
+    VkCheck(vmaCreatePool(context.allocator, &poolInfo, &memory->voxelPool));
+    vmaSetPoolName(context.allocator, memory->voxelPool, "voxels");
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.extent = {1024, 1024, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    poolInfo = {};
+    VkCheck(vmaFindMemoryTypeIndexForImageInfo(context.allocator, &imageInfo, &allocInfo, &poolInfo.memoryTypeIndex));
+    VkCheck(vmaCreatePool(context.allocator, &poolInfo, &memory->imagePool));
+    vmaSetPoolName(context.allocator, memory->imagePool, "images");
+
+    return Success;
+}
+
+void DestroyMemoryPools(MemoryTracker *memory) {
+    vmaDestroyPool(context.allocator, memory->imagePool);
+    vmaDestroyPool(context.allocator, memory->voxelPool);
+    memory->imagePool = VK_NULL_HANDLE;
+    memory->voxelPool = VK_NULL_HANDLE;
+}
+
+VmaPool GetBufferPool(MemoryCategory category) {
+    return category == MemoryCategoryVoxels ? context.memory.voxelPool : VK_NULL_HANDLE;
+}
+
+VmaPool GetImagePool(MemoryCategory category) {
+    return category == MemoryCategoryImages ? context.memory.imagePool : VK_NULL_HANDLE;
+}
+
+const char *GetMemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategoryGeneral: return "general";
+        case MemoryCategoryVoxels: return "voxels";
+        case MemoryCategoryFields: return "fields";
+        case MemoryCategoryMeshes: return "meshes";
+        case MemoryCategoryStaging: return "staging";
+        case MemoryCategoryImages: return "images";
+        default: return "unknown";
+    }
+}
+
+// The category rides along in the allocation's user data so untracking needs nothing but the allocation.
+void TrackAllocation(VmaAllocation alloc, MemoryCategory category) {
+    vmaSetAllocationUserData(context.allocator, alloc, (void *)(uintptr_t)category);
+    vmaSetAllocationName(context.allocator, alloc, GetMemoryCategoryName(category));
+
+    VmaAllocationInfo info = {};
+    vmaGetAllocationInfo(context.allocator, alloc, &info);
+
+    context.memory.categoryBytes[category] += info.size;
+    context.memory.categoryCounts[category]++;
+}
+
+void UntrackAllocation(VmaAllocation alloc) {
+    VmaAllocationInfo info = {};
+    vmaGetAllocationInfo(context.allocator, alloc, &info);
+
+    MemoryCategory category = (MemoryCategory)(uintptr_t)info.pUserData;
+    context.memory.categoryBytes[category] -= info.size;
+    context.memory.categoryCounts[category]--;
+}
+
+static void QueryMemoryBudget(MemoryBudget *budget) {
+    const VkPhysicalDeviceMemoryProperties *props = nullptr;
+    vmaGetMemoryProperties(context.allocator, &props);
+
+    budget->heapCount = props->memoryHeapCount;
+    vmaGetHeapBudgets(context.allocator, budget->heaps.data());
+
+    budget->deviceUsage = 0;
+    budget->deviceBudget = 0;
+    for (uint32_t i = 0; i < budget->heapCount; i++) {
+        if (props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            budget->deviceUsage += budget->heaps[i].usage;
+            budget->deviceBudget += budget->heaps[i].budget;
+        }
+    }
+}
+
+void UpdateMemoryBudget(uint32_t frameIndex) {
+    MemoryTracker &memory = context.memory;
+
+    vmaSetCurrentFrameIndex(context.allocator, frameIndex);
+    if (frameIndex % MemoryBudgetInterval != 0) {
+        return;
+    }
+
+    QueryMemoryBudget(&memory.budget);
+    memory.pressure = memory.budget.deviceBudget > 0 ? (float)memory.budget.deviceUsage / (float)memory.budget.deviceBudget : 0.0f;
+
+    if (memory.pressure > MemoryPressureWarning && !memory.warned) {
+        printf("GPU memory pressure: %llu of %llu MiB device-local budget in use\n",
+            (unsigned long long)(memory.budget.deviceUsage >> 20), (unsigned long long)(memory.budget.deviceBudget >> 20));
+        memory.warned = true;
+    } else if (memory.pressure <= MemoryPressureWarning) {
+        memory.warned = false;
+    }
+}
+
+float GetMemoryPressure() {
+    return context.memory.pressure;
+}
+
+void PrintMemoryStats() {
+    QueryMemoryBudget(&context.memory.budget);
+    const MemoryBudget &budget = context.memory.budget;
+
+    printf("GPU memory (%s):\n", context.memory.budgetExtension ? "VK_EXT_memory_budget" : "estimated budget");
+    for (uint32_t i = 0; i < budget.heapCount; i++) {
+        const VmaBudget &heap = budget.heaps[i];
+        printf("  heap %u: %llu / %llu MiB used, %llu MiB in %u allocations, %u blocks\n", i,
+            (unsigned long long)(heap.usage >> 20), (unsigned long long)(heap.budget >> 20),
+            (unsigned long long)(heap.statistics.allocationBytes >> 20), heap.statistics.allocationCount, heap.statistics.blockCount);
+    }
+
+    for (uint32_t i = 0; i < MemoryCategoryCount; i++) {
+        printf("  %-8s %8.2f MiB in %u allocations\n", GetMemoryCategoryName((MemoryCategory)i),
+            (double)context.memory.categoryBytes[i] / (1024.0 * 1024.0), context.memory.categoryCounts[i].load());
+    }
+}
+
+bool DumpMemoryStats(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Failed to open '%s' for memory stats\n", path);
+        return false;
+    }
+
+    char *stats = nullptr;
+    vmaBuildStatsString(context.allocator, &stats, VK_TRUE);
+    fputs(stats, file);
+    vmaFreeStatsString(context.allocator, stats);
+
+    fclose(file);
+    return true;
+}
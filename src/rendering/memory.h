@@ -0,0 +1,71 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <Volk/volk.h>
+#include <vma/vk_mem_alloc.h>
+
+#include <array>
+#include <atomic>
+
+enum MemoryCategory : uint32_t {
+    MemoryCategoryGeneral,
+    MemoryCategoryVoxels,
+    // Acceleration structures derived from the voxels. Their descriptors are written once, so they
+    // cannot be moved and stay out of the defragmented voxel pool.
+    MemoryCategoryFields,
+    // Chunk vertex and index buffers for the raster pass.
+    MemoryCategoryMeshes,
+    MemoryCategoryStaging,
+    MemoryCategoryImages,
+    MemoryCategoryCount
+};
+
+// Heap budgets are refreshed every MemoryBudgetInterval frames; VMA tracks allocations made in between.
+constexpr uint32_t MemoryBudgetInterval = 30;
+constexpr float MemoryPressureWarning = 0.9f;
+
+struct MemoryBudget {
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> heaps;
+    uint32_t heapCount;
+
+    // Summed over device-local heaps.
+    VkDeviceSize deviceUsage;
+    VkDeviceSize deviceBudget;
+};
+
+struct MemoryTracker {
+    // Voxel storage and screen-sized images get their own block lists so neither fragments the other
+    // or the default heap.
+    VmaPool voxelPool;
+    VmaPool imagePool;
+
+    bool budgetExtension;
+    MemoryBudget budget;
+    float pressure;
+    bool warned;
+
+    std::array<std::atomic<uint64_t>, MemoryCategoryCount> categoryBytes;
+    std::array<std::atomic<uint32_t>, MemoryCategoryCount> categoryCounts;
+};
+
+enum Result : int;
+
+Result CreateMemoryPools(MemoryTracker *memory);
+void DestroyMemoryPools(MemoryTracker *memory);
+VmaPool GetBufferPool(MemoryCategory category);
+VmaPool GetImagePool(MemoryCategory category);
+
+const char *GetMemoryCategoryName(MemoryCategory category);
+
+void TrackAllocation(VmaAllocation alloc, MemoryCategory category);
+void UntrackAllocation(VmaAllocation alloc);
+
+void UpdateMemoryBudget(uint32_t frameIndex);
+// Fraction of the device-local budget in use. Above MemoryPressureWarning voxel grid replacement is refused and
+// defragmentation doesn't start.
+float GetMemoryPressure();
+
+void PrintMemoryStats();
+bool DumpMemoryStats(const char *path);
+
+#endif // MEMORY_H
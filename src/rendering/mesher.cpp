@@ -0,0 +1,284 @@
+#include "mesher.h"
+
+#include "context.h"
+#include "vkutil.h"
+#include "../core/jobs.h"
+
+#include <algorithm>
+#include <array>
+
+constexpr VkFormat MeshDepthFormat = VK_FORMAT_D32_SFLOAT;
+
+static Result CreateMeshRenderPass(MeshPass *pass) {
+    VkAttachmentDescription gbufferAttachment = {};
+    gbufferAttachment.flags = 0;
+    gbufferAttachment.format = VK_FORMAT_R32G32_UINT;
+    gbufferAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    gbufferAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    gbufferAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    gbufferAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    gbufferAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    gbufferAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    gbufferAttachment.finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkAttachmentDescription depthAttachment = gbufferAttachment;
+    depthAttachment.format = MeshDepthFormat;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference gbufferReference = {};
+    gbufferReference.attachment = 0;
+    gbufferReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthReference = {};
+    depthReference.attachment = 1;
+    depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.flags = 0;
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &gbufferReference;
+    subpass.pDepthStencilAttachment = &depthReference;
+
+    // The previous frame's compute passes read the G-buffer this pass clears, and this frame's read what it wrote.
+    VkSubpassDependency before = {};
+    before.srcSubpass = VK_SUBPASS_EXTERNAL;
+    before.dstSubpass = 0;
+    before.srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    before.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    before.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    before.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    VkSubpassDependency after = {};
+    after.srcSubpass = 0;
+    after.dstSubpass = VK_SUBPASS_EXTERNAL;
+    after.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    after.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    after.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    after.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    std::vector<VkAttachmentDescription> attachments = {gbufferAttachment, depthAttachment};
+    std::vector<VkSubpassDescription> subpasses = {subpass};
+    std::vector<VkSubpassDependency> dependencies = {before, after};
+    VkRenderPassCreateInfo renderPassInfo = GetRenderPassCreateInfo(attachments, subpasses, dependencies);
+    VkCheck(vkCreateRenderPass(context.device, &renderPassInfo, nullptr, &pass->renderPass));
+
+    return Success;
+}
+
+// Every chunk draws from the same index buffer, as quads are always split the same way.
+static Result CreateQuadIndices(MeshPass *pass) {
+    std::vector<uint16_t> indices(MaxChunkQuads * 6);
+    for (uint32_t quad = 0; quad < MaxChunkQuads; quad++) {
+        uint16_t base = (uint16_t)(quad * 4);
+        uint16_t *index = &indices[quad * 6];
+        index[0] = base;
+        index[1] = base + 1;
+        index[2] = base + 2;
+        index[3] = base + 2;
+        index[4] = base + 3;
+        index[5] = base;
+    }
+
+    uint32_t bytes = (uint32_t)(sizeof(uint16_t) * indices.size());
+    pass->indices = CreateBuffer(bytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryMeshes);
+    if (pass->indices.buffer == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+    if (CopyToBuffer(&pass->indices, (uint8_t *)indices.data(), bytes) != Success) {
+        DestroyBuffer(&pass->indices);
+        return ErrorAllocatingMemory;
+    }
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+    BufferBarrier(cmd, pass->indices, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+    EndSingleUseCmd(cmd);
+
+    return Success;
+}
+
+Result CreateMeshPass(MeshPass *pass, uint32_t width, uint32_t height) {
+    ResCheck(CreateMeshRenderPass(pass));
+
+    GraphicsPipelineState state = {};
+    state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    state.vertexBindings = {{0, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_VERTEX}};
+    state.vertexAttributes = {{0, 0, VK_FORMAT_R32_UINT, 0}};
+    state.cullMode = VK_CULL_MODE_BACK_BIT;
+    state.depthTest = true;
+    pass->pipeline = CreateGraphicsPipeline({"../../res/shaders/mesh.vert", "../../res/shaders/mesh.frag"}, pass->renderPass, state);
+    BindFrameConstants(pass->pipeline.set, 0, context.frameConstants);
+
+    ResCheck(CreateQuadIndices(pass));
+
+    glm::ivec3 gridSize(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth);
+    pass->chunkCount = (gridSize + ChunkSize - 1) / ChunkSize;
+    pass->chunks.resize(pass->chunkCount.x * pass->chunkCount.y * pass->chunkCount.z);
+    for (int z = 0; z < pass->chunkCount.z; z++) {
+        for (int y = 0; y < pass->chunkCount.y; y++) {
+            for (int x = 0; x < pass->chunkCount.x; x++) {
+                ChunkMesh &chunk = pass->chunks[x + y * pass->chunkCount.x + z * pass->chunkCount.x * pass->chunkCount.y];
+                chunk.origin = glm::ivec3(x, y, z) * ChunkSize;
+            }
+        }
+    }
+
+    return ResizeMeshPass(pass, width, height);
+}
+
+Result ResizeMeshPass(MeshPass *pass, uint32_t width, uint32_t height) {
+    if (pass->framebuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(context.device, pass->framebuffer, nullptr);
+        pass->framebuffer = VK_NULL_HANDLE;
+    }
+    DestroyImage(&pass->depth);
+
+    pass->depth = CreateImage(MeshDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, width, height);
+    if (pass->depth.image == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+
+    std::vector<VkImageView> attachments = {context.gbuffer.view, pass->depth.view};
+    VkFramebufferCreateInfo framebufferInfo = GetFramebufferCreateInfo(pass->renderPass, attachments, {width, height});
+    VkCheck(vkCreateFramebuffer(context.device, &framebufferInfo, nullptr, &pass->framebuffer));
+
+    return Success;
+}
+
+void DestroyMeshPass(MeshPass *pass) {
+    for (auto &chunk : pass->chunks) {
+        DestroyBuffer(&chunk.vertices);
+    }
+    pass->chunks.clear();
+
+    DestroyBuffer(&pass->indices);
+    DestroyImage(&pass->depth);
+    vkDestroyFramebuffer(context.device, pass->framebuffer, nullptr);
+    DestroyPipeline(&pass->pipeline);
+    vkDestroyRenderPass(context.device, pass->renderPass, nullptr);
+}
+
+Result RemeshChunks(MeshPass *pass, const std::vector<int> &data, glm::ivec3 min, glm::ivec3 max) {
+    // A voxel also decides whether its neighbours' faces show, so the box grows by one on each side.
+    glm::ivec3 chunkMin = glm::clamp((min - 1) / ChunkSize, glm::ivec3(0), pass->chunkCount - 1);
+    glm::ivec3 chunkMax = glm::clamp(max / ChunkSize, glm::ivec3(0), pass->chunkCount - 1);
+
+    std::vector<uint32_t> dirty;
+    for (int z = chunkMin.z; z <= chunkMax.z; z++) {
+        for (int y = chunkMin.y; y <= chunkMax.y; y++) {
+            for (int x = chunkMin.x; x <= chunkMax.x; x++) {
+                dirty.push_back(x + y * pass->chunkCount.x + z * pass->chunkCount.x * pass->chunkCount.y);
+            }
+        }
+    }
+
+    glm::ivec3 gridSize(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth);
+    // A chunk is plenty of work for one job.
+    std::vector<std::vector<uint32_t>> meshes(dirty.size());
+    ParallelFor((uint32_t)dirty.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t i = begin; i < end; i++) {
+            MeshChunk(data, gridSize, pass->chunks[dirty[i]].origin, meshes[i]);
+        }
+    });
+
+    BeginImmediateBatch();
+
+    Result result = Success;
+    for (size_t i = 0; i < dirty.size(); i++) {
+        ChunkMesh &chunk = pass->chunks[dirty[i]];
+        if (chunk.vertices.buffer != VK_NULL_HANDLE) {
+            DeferDestroyBuffer(chunk.vertices);
+        }
+        chunk.vertices = {};
+        chunk.quadCount = 0;
+
+        if (meshes[i].empty()) {
+            continue;
+        }
+
+        uint32_t bytes = (uint32_t)(sizeof(uint32_t) * meshes[i].size());
+        chunk.vertices = CreateBuffer(bytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryMeshes);
+        if (chunk.vertices.buffer == VK_NULL_HANDLE) {
+            result = ErrorAllocatingMemory;
+            continue;
+        }
+
+        if (CopyToBuffer(&chunk.vertices, (uint8_t *)meshes[i].data(), bytes) != Success) {
+            DestroyBuffer(&chunk.vertices);
+            result = ErrorAllocatingMemory;
+            continue;
+        }
+        chunk.quadCount = (uint32_t)meshes[i].size() / 4;
+    }
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+    for (uint32_t index : dirty) {
+        if (pass->chunks[index].quadCount > 0) {
+            BufferBarrier(cmd, pass->chunks[index].vertices, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        }
+    }
+    EndSingleUseCmd(cmd);
+
+    EndImmediateBatch();
+    return result;
+}
+
+// Conservative: a chunk is skipped only when all eight corners lie outside the same clip plane.
+static bool IsChunkVisible(const glm::mat4 &viewProjection, glm::ivec3 origin) {
+    std::array<glm::vec4, 8> corners;
+    for (int i = 0; i < 8; i++) {
+        glm::ivec3 corner = origin + ChunkSize * glm::ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        corners[i] = viewProjection * glm::vec4(glm::vec3(corner), 1.0f);
+    }
+
+    for (int plane = 0; plane < 6; plane++) {
+        int axis = plane >> 1;
+        float sign = (plane & 1) != 0 ? -1.0f : 1.0f;
+        bool outside = std::all_of(corners.begin(), corners.end(), [axis, sign](const glm::vec4 &c) { return sign * c[axis] > c.w; });
+        if (outside) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Writes the same G-buffer texels the march pass would, so lighting, shading and picking follow unchanged.
+void RecordMeshPass(VkCommandBuffer cmd, MeshPass *pass, const glm::mat4 &viewProjection) {
+    VkExtent2D extent = {pass->depth.width, pass->depth.height};
+
+    // Material 0 marks a miss, as it does for rays that leave the grid.
+    std::array<VkClearValue, 2> clears = {};
+    clears[1].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo passBeginInfo = GetRenderPassBeginInfo(pass->renderPass, pass->framebuffer, extent, glm::vec4(0.0f));
+    passBeginInfo.clearValueCount = (uint32_t)clears.size();
+    passBeginInfo.pClearValues = clears.data();
+
+    vkCmdBeginRenderPass(cmd, &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    VkViewport viewport = {0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0, 0}, extent};
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pass->pipeline.pipeline);
+    BindDescriptorSets(cmd, pass->pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    vkCmdBindIndexBuffer(cmd, pass->indices.buffer, 0, VK_INDEX_TYPE_UINT16);
+
+    for (const auto &chunk : pass->chunks) {
+        if (chunk.quadCount == 0 || !IsChunkVisible(viewProjection, chunk.origin)) {
+            continue;
+        }
+
+        MeshPushConstants push = {};
+        push.chunkOrigin = glm::ivec4(chunk.origin, 0);
+        vkCmdPushConstants(cmd, pass->pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(cmd, 0, 1, &chunk.vertices.buffer, &offset);
+        vkCmdDrawIndexed(cmd, chunk.quadCount * 6, 1, 0, 0, 0);
+    }
+
+    vkCmdEndRenderPass(cmd);
+}
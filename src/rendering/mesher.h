@@ -0,0 +1,49 @@
+#ifndef MESHER_H
+#define MESHER_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "buffer.h"
+#include "chunkmesh.h"
+#include "image.h"
+#include "pipeline.h"
+
+struct ChunkMesh {
+    glm::ivec3 origin;
+    // Four vertices per quad; the quads share MeshPass::indices.
+    Buffer vertices;
+    uint32_t quadCount;
+};
+
+// Rasterises greedy-meshed chunks of the grid straight into the G-buffer, in place of the march pass.
+struct MeshPass {
+    Pipeline pipeline;
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+    Image depth;
+    Buffer indices;
+
+    glm::ivec3 chunkCount;
+    std::vector<ChunkMesh> chunks;
+};
+
+struct MeshPushConstants {
+    glm::ivec4 chunkOrigin;
+};
+
+enum Result : int;
+
+Result CreateMeshPass(MeshPass *pass, uint32_t width, uint32_t height);
+// Call after the G-buffer is recreated; the framebuffer holds its view.
+Result ResizeMeshPass(MeshPass *pass, uint32_t width, uint32_t height);
+void DestroyMeshPass(MeshPass *pass);
+
+// data is the whole grid. Chunks whose faces can change with voxels in [min, max) are meshed in
+// parallel and their vertex buffers replaced; a chunk whose buffer can't be allocated draws nothing.
+Result RemeshChunks(MeshPass *pass, const std::vector<int> &data, glm::ivec3 min, glm::ivec3 max);
+void RecordMeshPass(VkCommandBuffer cmd, MeshPass *pass, const glm::mat4 &viewProjection);
+
+#endif // MESHER_H
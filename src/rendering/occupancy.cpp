@@ -0,0 +1,62 @@
+#include "occupancy.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+struct OccupancyPushConstants {
+    glm::ivec4 regionMin;
+    glm::ivec4 regionMax;
+    int32_t level;
+    uint64_t voxelAddress;
+};
+
+static glm::ivec3 GetLevelSize(int32_t level) {
+    return glm::max(glm::ivec3(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth) >> level, glm::ivec3(1));
+}
+
+Result CreateOccupancyPyramid(OccupancyPyramid *pyramid) {
+    uint32_t cellCount = 0;
+    for (int32_t level = 1; level <= OccupancyPyramidLevels; level++) {
+        glm::ivec3 size = GetLevelSize(level);
+        cellCount += size.x * size.y * size.z;
+    }
+
+    pyramid->cells = CreateBuffer(sizeof(uint32_t) * cellCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, MemoryCategoryFields);
+    if (pyramid->cells.buffer == VK_NULL_HANDLE) {
+        return ErrorAllocatingMemory;
+    }
+
+    pyramid->pipeline = CreateComputePipeline("../../res/shaders/pyramid.comp", GetVoxelShaderDefines());
+
+    BindStorageBuffer(pyramid->pipeline.set, 1, pyramid->cells);
+
+    return Success;
+}
+
+void DestroyOccupancyPyramid(OccupancyPyramid *pyramid) {
+    DestroyPipeline(&pyramid->pipeline);
+    DestroyBuffer(&pyramid->cells);
+}
+
+void BuildOccupancyPyramid(VkCommandBuffer cmd, OccupancyPyramid *pyramid, glm::ivec3 dirtyMin, glm::ivec3 dirtyMax) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid->pipeline.pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pyramid->pipeline.layout, 0, 1, &pyramid->pipeline.set, 0, nullptr);
+
+    for (int32_t level = 1; level <= OccupancyPyramidLevels; level++) {
+        int32_t cellSize = 1 << level;
+        glm::ivec3 min = dirtyMin / cellSize;
+        glm::ivec3 max = glm::min((dirtyMax + cellSize - 1) / cellSize, GetLevelSize(level));
+        glm::ivec3 extent = max - min;
+
+        OccupancyPushConstants push = {};
+        push.regionMin = glm::ivec4(min, 0);
+        push.regionMax = glm::ivec4(max, 0);
+        push.level = level;
+        push.voxelAddress = context.voxelData.address;
+
+        vkCmdPushConstants(cmd, pyramid->pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+        vkCmdDispatch(cmd, (extent.x + 3) / 4, (extent.y + 3) / 4, (extent.z + 3) / 4);
+
+        BufferBarrier(cmd, pyramid->cells, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+}
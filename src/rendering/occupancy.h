@@ -0,0 +1,25 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include "buffer.h"
+#include "pipeline.h"
+
+constexpr int32_t OccupancyPyramidLevels = 6;
+
+// Each cell holds an occupancy bit for empty-space skipping and a majority material the DDA march
+// uses as a downsampled volume for distant rays; see common.glsl.
+struct OccupancyPyramid {
+    Buffer cells;
+    Pipeline pipeline;
+};
+
+enum Result : int;
+
+Result CreateOccupancyPyramid(OccupancyPyramid *pyramid);
+void DestroyOccupancyPyramid(OccupancyPyramid *pyramid);
+void BuildOccupancyPyramid(VkCommandBuffer cmd, OccupancyPyramid *pyramid, glm::ivec3 dirtyMin, glm::ivec3 dirtyMax);
+
+#endif // OCCUPANCY_H
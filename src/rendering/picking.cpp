@@ -0,0 +1,175 @@
+#include "picking.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+#include <algorithm>
+#include <cfloat>
+
+Result CreatePickPass(PickPass *pass) {
+    pass->pipeline = CreateComputePipeline("../../res/shaders/pick.comp", GetVoxelShaderDefines());
+
+    BindStorageImage(pass->pipeline.set, 0, context.gbuffer);
+    BindStorageBuffer(pass->pipeline.set, 2, context.distanceField.distances);
+    BindStorageBuffer(pass->pipeline.set, 3, context.occupancyPyramid.cells);
+    BindFrameConstants(pass->pipeline.set, 4, context.frameConstants);
+
+    return Success;
+}
+
+void DestroyPickPass(PickPass *pass) {
+    DestroyPipeline(&pass->pipeline);
+    pass->pending.clear();
+    pass->completed.clear();
+    pass->cancelled.clear();
+}
+
+Result CreatePickSlot(PickSlot *slot) {
+    // Read back by the host, so cached memory is preferred.
+    slot->buffer = CreateBuffer(sizeof(PickBuffer), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    VkCheck(vmaMapMemory(context.allocator, slot->buffer.alloc, (void **)&slot->mapped));
+    slot->handle = RegisterBindlessBuffer(slot->buffer);
+
+    return Success;
+}
+
+void DestroyPickSlot(PickSlot *slot) {
+    if (slot->buffer.buffer != VK_NULL_HANDLE) {
+        vmaUnmapMemory(context.allocator, slot->buffer.alloc);
+    }
+    DestroyBuffer(&slot->buffer);
+    slot->mapped = nullptr;
+    slot->tickets.clear();
+}
+
+PickTicket RequestPick(glm::ivec2 pixel) {
+    PickPass &pass = context.pickPass;
+    PickTicket ticket = ++pass.nextTicket;
+    if (ticket == InvalidPickTicket) {
+        ticket = ++pass.nextTicket;
+    }
+
+    pass.pending.push_back({ticket, pixel});
+    return ticket;
+}
+
+bool GetPickResult(PickTicket ticket, PickResult *result) {
+    auto &completed = context.pickPass.completed;
+    auto it = completed.find(ticket);
+    if (it == completed.end()) {
+        return false;
+    }
+
+    *result = it->second;
+    completed.erase(it);
+    return true;
+}
+
+void CancelPick(PickTicket ticket) {
+    PickPass &pass = context.pickPass;
+    if (ticket == InvalidPickTicket || pass.completed.erase(ticket) > 0) {
+        return;
+    }
+
+    for (auto it = pass.pending.begin(); it != pass.pending.end(); it++) {
+        if (it->ticket == ticket) {
+            pass.pending.erase(it);
+            return;
+        }
+    }
+
+    // Tickets already handed out are in no slot and need nothing.
+    for (const auto &frame : context.frames) {
+        const auto &tickets = frame.pickSlot.tickets;
+        if (std::find(tickets.begin(), tickets.end(), ticket) != tickets.end()) {
+            pass.cancelled.insert(ticket);
+            return;
+        }
+    }
+}
+
+RayHit PickVoxel(glm::ivec2 pixel) {
+    CameraConstants camera = GetCameraConstants(context.camera, context.renderImage.width, context.renderImage.height);
+
+    RayQuery ray = {};
+    ray.origin = glm::vec3(camera.origin);
+    ray.dir = glm::normalize(glm::vec3(camera.rayCorner + (float)pixel.x * camera.rayDx + (float)pixel.y * camera.rayDy));
+    ray.maxDistance = FLT_MAX;
+    return CastRay(ray);
+}
+
+void CollectPickResults(PickSlot *slot) {
+    if (slot->tickets.empty()) {
+        return;
+    }
+
+    vmaInvalidateAllocation(context.allocator, slot->buffer.alloc, 0, VK_WHOLE_SIZE);
+    const PickBuffer *data = (const PickBuffer *)slot->mapped;
+
+    for (size_t i = 0; i < slot->tickets.size(); i++) {
+        if (context.pickPass.cancelled.erase(slot->tickets[i]) > 0) {
+            continue;
+        }
+
+        const GpuPickResult &gpu = data->results[i];
+
+        PickResult result = {};
+        result.hit = gpu.info.z != 0;
+        result.distance = gpu.position.w;
+        result.position = glm::vec3(gpu.position);
+        result.voxel = glm::ivec3(gpu.voxel);
+        result.face = gpu.info.x;
+        result.instance = gpu.info.y;
+        result.material = gpu.info.z;
+        context.pickPass.completed[slot->tickets[i]] = result;
+    }
+
+    slot->tickets.clear();
+}
+
+uint32_t AssignPickRequests(PickSlot *slot) {
+    auto &pending = context.pickPass.pending;
+    PickBuffer *data = (PickBuffer *)slot->mapped;
+
+    uint32_t count = 0;
+    while (!pending.empty() && count < MaxPickRequests) {
+        data->pixels[count] = glm::ivec4(pending.front().pixel, 0, 0);
+        slot->tickets.push_back(pending.front().ticket);
+        pending.pop_front();
+        count++;
+    }
+
+    data->count = count;
+    if (count > 0) {
+        vmaFlushAllocation(context.allocator, slot->buffer.alloc, 0, VK_WHOLE_SIZE);
+    }
+
+    return count;
+}
+
+void DropPickRequests() {
+    PickPass &pass = context.pickPass;
+    for (const auto &pick : pass.pending) {
+        PickResult result = {};
+        result.instance = NoInstance;
+        pass.completed[pick.ticket] = result;
+    }
+    pass.pending.clear();
+}
+
+// Reads the G-buffer the march pass already wrote, so the base grid costs no extra traversal. Hits
+// on instances re-trace their pixel with the march pass's footprint to learn which instance and voxel
+// it was.
+void RecordPickPass(VkCommandBuffer cmd, PickPass *pass, const PickSlot &slot, uint64_t voxelAddress) {
+    PickPushConstants push = {};
+    push.requests = slot.handle;
+    push.lodScale = context.settings.lodScale;
+    push.voxelAddress = voxelAddress;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pass->pipeline.pipeline);
+    BindDescriptorSets(cmd, pass->pipeline);
+    vkCmdPushConstants(cmd, pass->pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, 1, 1, 1);
+
+    BufferBarrier(cmd, slot.buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
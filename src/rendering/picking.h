@@ -0,0 +1,106 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer.h"
+#include "bindless.h"
+#include "pipeline.h"
+#include "scene.h"
+#include "../world/world.h"
+
+// Requests beyond this in one frame wait for the next.
+constexpr uint32_t MaxPickRequests = 16;
+constexpr InstanceHandle NoInstance = UINT32_MAX;
+
+using PickTicket = uint32_t;
+constexpr PickTicket InvalidPickTicket = 0;
+
+struct PickResult {
+    bool hit;
+    float distance;
+    glm::vec3 position;
+    // Voxel of the shared grid; for instances, inside the instance's model box.
+    glm::ivec3 voxel;
+    uint32_t face;
+    uint32_t material;
+    InstanceHandle instance;
+};
+
+// std430 mirrors of PickResult and PickBuffer in pick.comp. info is (face, instance, material, 0).
+struct GpuPickResult {
+    glm::ivec4 voxel;
+    glm::vec4 position;
+    glm::uvec4 info;
+};
+
+struct PickBuffer {
+    uint32_t count;
+    uint32_t padding[3];
+    glm::ivec4 pixels[MaxPickRequests];
+    GpuPickResult results[MaxPickRequests];
+};
+
+// One per frame in flight. Written before the frame is submitted and read back once its fences
+// have signalled, so results arrive with the frame that served them and nothing waits on the queue.
+struct PickSlot {
+    Buffer buffer;
+    uint8_t *mapped;
+    BindlessHandle handle;
+    std::vector<PickTicket> tickets;
+};
+
+struct PendingPick {
+    PickTicket ticket;
+    glm::ivec2 pixel;
+};
+
+struct PickPass {
+    Pipeline pipeline;
+
+    std::deque<PendingPick> pending;
+    std::unordered_map<PickTicket, PickResult> completed;
+    // Cancelled while a slot was serving them; their results are dropped on collection.
+    std::unordered_set<PickTicket> cancelled;
+    PickTicket nextTicket;
+};
+
+struct PickPushConstants {
+    BindlessHandle requests;
+    float lodScale;
+    uint64_t voxelAddress;
+};
+
+enum Result : int;
+
+Result CreatePickPass(PickPass *pass);
+void DestroyPickPass(PickPass *pass);
+Result CreatePickSlot(PickSlot *slot);
+void DestroyPickSlot(PickSlot *slot);
+
+// pixel is in renderImage coordinates. Results are ready a frame or two later.
+PickTicket RequestPick(glm::ivec2 pixel);
+// Hands out each result once; false while the request is still in flight.
+bool GetPickResult(PickTicket ticket, PickResult *result);
+// For requests whose result is no longer wanted; otherwise it is kept until fetched.
+void CancelPick(PickTicket ticket);
+
+// Casts the camera ray through a renderImage pixel against the CPU copy of the grid, matching the
+// primary rays of the compute pass. Reads the current camera, so call it from the thread that renders.
+RayHit PickVoxel(glm::ivec2 pixel);
+
+// Call after the slot's fences have signalled.
+void CollectPickResults(PickSlot *slot);
+// Moves up to MaxPickRequests pending requests into the slot and returns how many it took.
+uint32_t AssignPickRequests(PickSlot *slot);
+// Answers every pending request as a miss, for render paths that keep no G-buffer.
+void DropPickRequests();
+void RecordPickPass(VkCommandBuffer cmd, PickPass *pass, const PickSlot &slot, uint64_t voxelAddress);
+
+#endif // PICKING_H
@@ -1,11 +1,13 @@
 #include "pipeline.h"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <cassert>
 #include <filesystem>
+#include <memory>
 
 #include <shaderc/shaderc.hpp>
 #include <spirv_cross/spirv_reflect.hpp>
@@ -13,12 +15,64 @@
 #include "vkutil.h"
 #include "context.h"
 
-static std::vector<uint32_t> CompileShader(shaderc_shader_kind kind, const std::string &filename) {
+struct ShaderInclude {
+    std::string name;
+    std::string content;
+};
+
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
+public:
+    shaderc_include_result *GetInclude(const char *requestedSource, shaderc_include_type type, const char *requestingSource, size_t includeDepth) override {
+        std::filesystem::path path = std::filesystem::path(requestingSource).parent_path() / requestedSource;
+
+        ShaderInclude *include = new ShaderInclude();
+        std::ifstream file(path);
+        if (file.is_open()) {
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+
+            include->name = path.string();
+            include->content = buffer.str();
+        } else {
+            include->content = "Failed to open include file: " + path.string();
+        }
+
+        shaderc_include_result *result = new shaderc_include_result();
+        result->source_name = include->name.c_str();
+        result->source_name_length = include->name.size();
+        result->content = include->content.c_str();
+        result->content_length = include->content.size();
+        result->user_data = include;
+
+        return result;
+    }
+
+    void ReleaseInclude(shaderc_include_result *data) override {
+        delete (ShaderInclude *)data->user_data;
+        delete data;
+    }
+};
+
+static std::vector<uint32_t> CompileShader(shaderc_shader_kind kind, const std::string &filename, const std::vector<std::string> &defines = {}) {
     shaderc::Compiler compiler;
     shaderc::CompileOptions options;
+    options.SetIncluder(std::make_unique<ShaderIncluder>());
+    // Matches the instance and device version; subgroup operations need SPIR-V 1.3 or later.
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+
+    for (const auto &define : defines) {
+        size_t separator = define.find('=');
+        if (separator == std::string::npos) {
+            options.AddMacroDefinition(define);
+        } else {
+            options.AddMacroDefinition(define.substr(0, separator), define.substr(separator + 1));
+        }
+    }
 
 #ifndef VOXEL_DEBUG
     options.SetOptimizationLevel(shaderc_optimization_level_size);
+    // Callers bind resources by index whether or not a variant reads them, so the layout must keep them.
+    options.SetPreserveBindings(true);
 #endif
 
     std::ifstream file(filename);
@@ -30,7 +84,7 @@ static std::vector<uint32_t> CompileShader(shaderc_shader_kind kind, const std::
     std::stringstream buffer;
     buffer << file.rdbuf();
 
-    shaderc::SpvCompilationResult compResult = compiler.CompileGlslToSpv(buffer.str(), kind, filename.c_str());
+    shaderc::SpvCompilationResult compResult = compiler.CompileGlslToSpv(buffer.str(), kind, filename.c_str(), options);
     if (compResult.GetCompilationStatus() != shaderc_compilation_status_success) {
         printf("Failed to compile shader %s: %s\n", filename.c_str(), compResult.GetErrorMessage().c_str());
         assert(false);
@@ -64,16 +118,36 @@ static inline VkShaderStageFlagBits KindToStage(shaderc_shader_kind kind) {
     return VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
 }
 
-Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkRenderPass renderPass) {
+// Adds a binding, or widens its stages when another stage already declared it.
+static void AddBinding(std::vector<VkDescriptorSetLayoutBinding> &bindings, uint32_t index, VkDescriptorType type, VkShaderStageFlags stage) {
+    for (auto &binding : bindings) {
+        if (binding.binding == index) {
+            binding.stageFlags |= stage;
+            return;
+        }
+    }
+
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = index;
+    binding.descriptorType = type;
+    binding.descriptorCount = 1;
+    binding.stageFlags = stage;
+    binding.pImmutableSamplers = nullptr;
+    bindings.push_back(binding);
+}
+
+Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkRenderPass renderPass, const GraphicsPipelineState &state) {
     std::vector<VkPipelineShaderStageCreateInfo> stages;
-    std::vector<uint32_t> fragCode;
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    VkPushConstantRange pushRange = {};
+
+    Pipeline pipeline = {};
 
     for (auto &shaderPath : shaderPaths) {
         std::filesystem::path p(shaderPath);
         auto ext = p.extension().string();
         shaderc_shader_kind kind = ExtToKind(ext);
         auto code = CompileShader(kind, shaderPath);
-        if (kind == shaderc_fragment_shader) fragCode = code;
         
         VkShaderModule mod;
         VkShaderModuleCreateInfo moduleInfo = GetShaderModuleCreateInfo(code);
@@ -82,22 +156,32 @@ Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkR
         VkShaderStageFlagBits stage = KindToStage(kind);
         VkPipelineShaderStageCreateInfo stageInfo = GetPipelineShaderStageCreateInfo(stage, mod);
         stages.push_back(stageInfo);
-    }
-    
-    Pipeline pipeline = {};
 
-    spirv_cross::Compiler comp(std::move(fragCode));
-    spirv_cross::ShaderResources resources = comp.get_shader_resources();
+        spirv_cross::Compiler comp(std::move(code));
+        spirv_cross::ShaderResources resources = comp.get_shader_resources();
 
-    std::vector<VkDescriptorSetLayoutBinding> bindings;
-    for (const auto &image : resources.sampled_images) {
-        VkDescriptorSetLayoutBinding binding = {};
-        binding.binding = comp.get_decoration(image.id, spv::DecorationBinding);
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        binding.descriptorCount = 1;
-        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        binding.pImmutableSamplers = nullptr;
-        bindings.push_back(binding);
+        for (const auto &image : resources.sampled_images) {
+            AddBinding(bindings, comp.get_decoration(image.id, spv::DecorationBinding), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stage);
+        }
+
+        for (const auto &buffer : resources.uniform_buffers) {
+            uint32_t count = (uint32_t)bindings.size();
+            AddBinding(bindings, comp.get_decoration(buffer.id, spv::DecorationBinding), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, stage);
+            if (bindings.size() > count) {
+                pipeline.dynamicOffsetCount++;
+            }
+        }
+
+        const auto &push = resources.push_constant_buffers;
+        if (!push.empty()) {
+            uint32_t size = (uint32_t)comp.get_declared_struct_size(comp.get_type(push[0].base_type_id));
+            pushRange.size = std::max(pushRange.size, size);
+            pushRange.stageFlags |= stage;
+        }
+    }
+
+    for (const auto &binding : bindings) {
+        pipeline.bindingMask |= 1ull << binding.binding;
     }
 
     VkDescriptorSetLayoutCreateInfo setLayoutInfo = GetDescriptorsetLayoutCreatInfo(bindings);
@@ -107,7 +191,12 @@ Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkR
     VkDescriptorSetAllocateInfo setAllocInfo = GetDescriptorSetAllocateInfo(context.descriptorPool, layouts);
     vkAllocateDescriptorSets(context.device, &setAllocInfo, &pipeline.set);
 
-    VkPipelineLayoutCreateInfo layoutInfo = GetPipelineLayoutCreateInfo(layouts, {});
+    std::vector<VkPushConstantRange> pushRanges;
+    if (pushRange.size > 0) {
+        pushRanges.push_back(pushRange);
+    }
+
+    VkPipelineLayoutCreateInfo layoutInfo = GetPipelineLayoutCreateInfo(layouts, pushRanges);
     vkCreatePipelineLayout(context.device, &layoutInfo, nullptr, &pipeline.layout);
 
     VkRect2D scissor = {};
@@ -122,15 +211,23 @@ Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkR
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = GetPipelineVertexInputStateCreateInfo({}, {});
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = GetPipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = GetPipelineVertexInputStateCreateInfo(state.vertexBindings, state.vertexAttributes);
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = GetPipelineInputAssemblyStateCreateInfo(state.topology);
     VkPipelineTessellationStateCreateInfo tessellationInfo = GetPipelineTessellationStateCreateInfo();
     VkPipelineViewportStateCreateInfo viewportInfo = GetPipelineViewportStateCreateInfo(viewport, scissor);
     VkPipelineRasterizationStateCreateInfo rasterizationInfo = GetPipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, 1.0f);
+    rasterizationInfo.cullMode = state.cullMode;
     VkPipelineMultisampleStateCreateInfo multisampleInfo = GetPipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT);
     VkPipelineDepthStencilStateCreateInfo depthStencilInfo = GetPipelineDepthStencilStateCreateInfo();
+    if (state.depthTest) {
+        depthStencilInfo.depthTestEnable = VK_TRUE;
+        depthStencilInfo.depthWriteEnable = VK_TRUE;
+        depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+    }
     VkPipelineColorBlendStateCreateInfo colorBlendInfo = GetPipelineColorBlendstateCreateInfo();
-    VkPipelineDynamicStateCreateInfo dynamicInfo = GetPipelineDynamicStateCreateInfo({});
+    // Viewport and scissor follow the swapchain, which is recreated on resize.
+    std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicInfo = GetPipelineDynamicStateCreateInfo(dynamicStates);
 
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -155,11 +252,26 @@ Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkR
 
     vkCreateGraphicsPipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline);
 
+    // Modules are only needed while the pipeline is being created.
+    for (const auto &stage : stages) {
+        vkDestroyShaderModule(context.device, stage.module, nullptr);
+    }
+
     return pipeline;
 }
 
-Pipeline CreateComputePipeline(const std::string &shaderPath) {
-    std::vector<uint32_t> code = CompileShader(shaderc_compute_shader, shaderPath);
+// Set 1 belongs to the shared bindless heap rather than the pipeline's own set.
+static bool IsBindlessResource(spirv_cross::Compiler &comp, const spirv_cross::Resource &resource, Pipeline *pipeline) {
+    if (comp.get_decoration(resource.id, spv::DecorationDescriptorSet) != BindlessSet) {
+        return false;
+    }
+
+    pipeline->bindless = true;
+    return true;
+}
+
+Pipeline CreateComputePipeline(const std::string &shaderPath, const std::vector<std::string> &defines) {
+    std::vector<uint32_t> code = CompileShader(shaderc_compute_shader, shaderPath, defines);
     VkShaderModuleCreateInfo moduleInfo = GetShaderModuleCreateInfo(code);
     VkShaderModule mod;
     vkCreateShaderModule(context.device, &moduleInfo, nullptr, &mod);
@@ -172,6 +284,10 @@ Pipeline CreateComputePipeline(const std::string &shaderPath) {
 
     std::vector<VkDescriptorSetLayoutBinding> bindings;
     for (const auto &image : resources.storage_images) {
+        if (IsBindlessResource(comp, image, &pipeline)) {
+            continue;
+        }
+
         VkDescriptorSetLayoutBinding binding = {};
         binding.binding = comp.get_decoration(image.id, spv::DecorationBinding);
         binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
@@ -182,6 +298,10 @@ Pipeline CreateComputePipeline(const std::string &shaderPath) {
     }
 
     for (const auto &buffer : resources.storage_buffers) {
+        if (IsBindlessResource(comp, buffer, &pipeline)) {
+            continue;
+        }
+
         VkDescriptorSetLayoutBinding binding = {};
         binding.binding = comp.get_decoration(buffer.id, spv::DecorationBinding);
         binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -191,19 +311,31 @@ Pipeline CreateComputePipeline(const std::string &shaderPath) {
         bindings.push_back(binding);
     }
 
+    // Uniform blocks are per-frame rings, selected with a dynamic offset at bind time.
+    for (const auto &buffer : resources.uniform_buffers) {
+        VkDescriptorSetLayoutBinding binding = {};
+        binding.binding = comp.get_decoration(buffer.id, spv::DecorationBinding);
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        binding.pImmutableSamplers = nullptr;
+        bindings.push_back(binding);
+        pipeline.dynamicOffsetCount++;
+    }
 
     std::vector<VkPushConstantRange> pushRanges;
 
     const auto &push = resources.push_constant_buffers;
     if (!push.empty()) {
-        uint32_t id = push[0].id;
-        for (auto &ranges : comp.get_active_buffer_ranges(id)) {
-            VkPushConstantRange range = {};
-            range.size = ranges.range;
-            range.offset = ranges.offset;
-            range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-            pushRanges.push_back(range);
-        }
+        VkPushConstantRange range = {};
+        range.offset = 0;
+        range.size = (uint32_t)comp.get_declared_struct_size(comp.get_type(push[0].base_type_id));
+        range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushRanges.push_back(range);
+    }
+
+    for (const auto &binding : bindings) {
+        pipeline.bindingMask |= 1ull << binding.binding;
     }
 
     VkDescriptorSetLayoutCreateInfo setLayoutInfo = GetDescriptorsetLayoutCreatInfo(bindings);
@@ -213,6 +345,10 @@ Pipeline CreateComputePipeline(const std::string &shaderPath) {
     VkDescriptorSetAllocateInfo setAllocInfo = GetDescriptorSetAllocateInfo(context.descriptorPool, layouts);
     vkAllocateDescriptorSets(context.device, &setAllocInfo, &pipeline.set);
 
+    if (pipeline.bindless) {
+        layouts.push_back(context.bindless.layout);
+    }
+
     VkPipelineLayoutCreateInfo layoutInfo = GetPipelineLayoutCreateInfo(layouts, pushRanges);
     vkCreatePipelineLayout(context.device, &layoutInfo, nullptr, &pipeline.layout);
 
@@ -226,6 +362,37 @@ Pipeline CreateComputePipeline(const std::string &shaderPath) {
     pipelineInfo.basePipelineIndex = 0;
 
     vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline);
+    vkDestroyShaderModule(context.device, mod, nullptr);
 
     return pipeline;
-}
\ No newline at end of file
+}
+
+bool HasBinding(const Pipeline &pipeline, uint32_t binding) {
+    return binding < 64 && (pipeline.bindingMask & (1ull << binding)) != 0;
+}
+
+// The descriptor set goes back with the pool; the pool is created without FREE_DESCRIPTOR_SET.
+void DestroyPipeline(Pipeline *pipeline) {
+    vkDestroyPipeline(context.device, pipeline->pipeline, nullptr);
+    vkDestroyPipelineLayout(context.device, pipeline->layout, nullptr);
+    vkDestroyDescriptorSetLayout(context.device, pipeline->setLayout, nullptr);
+    *pipeline = {};
+}
+
+VkDescriptorSet AllocateDescriptorSet(const Pipeline &pipeline) {
+    std::vector<VkDescriptorSetLayout> layouts = {pipeline.setLayout};
+    VkDescriptorSetAllocateInfo setAllocInfo = GetDescriptorSetAllocateInfo(context.descriptorPool, layouts);
+
+    VkDescriptorSet set;
+    vkAllocateDescriptorSets(context.device, &setAllocInfo, &set);
+    return set;
+}
+
+void BindDescriptorSets(VkCommandBuffer cmd, const Pipeline &pipeline, VkPipelineBindPoint bindPoint) {
+    uint32_t offset = context.frameConstants.stride * (context.frameCount % MaxFramesInFlight);
+    vkCmdBindDescriptorSets(cmd, bindPoint, pipeline.layout, 0, 1, &pipeline.set, pipeline.dynamicOffsetCount, &offset);
+
+    if (pipeline.bindless) {
+        vkCmdBindDescriptorSets(cmd, bindPoint, pipeline.layout, BindlessSet, 1, &context.bindless.set, 0, nullptr);
+    }
+}
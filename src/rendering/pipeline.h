@@ -12,9 +12,28 @@ struct Pipeline {
 
     VkDescriptorSetLayout setLayout;
     VkDescriptorSet set;
+    uint32_t dynamicOffsetCount;
+    bool bindless;
+    // Set 0 bindings the shaders declare, one bit per binding index.
+    uint64_t bindingMask;
 };
 
-Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkRenderPass renderPass);
-Pipeline CreateComputePipeline(const std::string &shaderPath);
+// Fixed-function state that differs between graphics pipelines; the defaults draw a vertex-less strip.
+struct GraphicsPipelineState {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    bool depthTest = false;
+};
+
+Pipeline CreateGraphicsPipeline(const std::vector<std::string> &shaderPaths, VkRenderPass renderPass, const GraphicsPipelineState &state = {});
+Pipeline CreateComputePipeline(const std::string &shaderPath, const std::vector<std::string> &defines = {});
+void DestroyPipeline(Pipeline *pipeline);
+// For code that writes one set of resources into several pipelines' sets.
+bool HasBinding(const Pipeline &pipeline, uint32_t binding);
+
+VkDescriptorSet AllocateDescriptorSet(const Pipeline &pipeline);
+void BindDescriptorSets(VkCommandBuffer cmd, const Pipeline &pipeline, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE);
 
 #endif // PIPELINE_H
\ No newline at end of file
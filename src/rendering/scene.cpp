@@ -0,0 +1,236 @@
+#include "scene.h"
+
+#include "context.h"
+#include "../core/jobs.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+Result CreateScene(Scene *scene) {
+    scene->frames.resize(MaxFramesInFlight);
+    for (auto &frame : scene->frames) {
+        frame.nodes.handle = InvalidBindlessHandle;
+        frame.instances.handle = InvalidBindlessHandle;
+    }
+
+    scene->bvh.nodeCount = 0;
+    return Success;
+}
+
+static void DestroyMappedBuffer(MappedBuffer *buffer) {
+    if (buffer->buffer.buffer != VK_NULL_HANDLE) {
+        vmaUnmapMemory(context.allocator, buffer->buffer.alloc);
+    }
+    DestroyBuffer(&buffer->buffer);
+    buffer->mapped = nullptr;
+}
+
+void DestroyScene(Scene *scene) {
+    for (auto &frame : scene->frames) {
+        DestroyMappedBuffer(&frame.nodes);
+        DestroyMappedBuffer(&frame.instances);
+    }
+    scene->frames.clear();
+}
+
+ModelHandle CreateVoxelModel(glm::ivec3 min, glm::ivec3 max) {
+    glm::ivec3 gridSize(VoxelGridWidth, VoxelGridHeight, VoxelGridDepth);
+    VoxelModel model = {};
+    model.min = glm::clamp(min - (min & (VoxelModelAlignment - 1)), glm::ivec3(0), gridSize);
+    model.max = glm::clamp((max + VoxelModelAlignment - 1) & ~(VoxelModelAlignment - 1), model.min, gridSize);
+
+    context.scene.models.push_back(model);
+    return (ModelHandle)(context.scene.models.size() - 1);
+}
+
+static bool IsLiveInstance(InstanceHandle instance) {
+    return instance < context.scene.instances.size() && context.scene.instances[instance].alive;
+}
+
+InstanceHandle CreateInstance(ModelHandle model, const glm::mat4 &transform) {
+    Scene &scene = context.scene;
+    if (model >= scene.models.size()) {
+        printf("Cannot instance unknown model %u\n", model);
+        return InvalidInstanceHandle;
+    }
+
+    InstanceHandle handle;
+    if (!scene.freeInstances.empty()) {
+        handle = scene.freeInstances.back();
+        scene.freeInstances.pop_back();
+    } else {
+        handle = (InstanceHandle)scene.instances.size();
+        scene.instances.push_back({});
+        scene.bounds.push_back({});
+    }
+
+    scene.instances[handle] = {model, transform, true};
+    scene.structureDirty = true;
+    return handle;
+}
+
+void SetInstanceTransform(InstanceHandle instance, const glm::mat4 &transform) {
+    if (!IsLiveInstance(instance)) {
+        return;
+    }
+
+    context.scene.instances[instance].transform = transform;
+    context.scene.transformsDirty = true;
+}
+
+void DestroyInstance(InstanceHandle instance) {
+    if (!IsLiveInstance(instance)) {
+        return;
+    }
+
+    Scene &scene = context.scene;
+    scene.instances[instance].alive = false;
+    scene.freeInstances.push_back(instance);
+    scene.structureDirty = true;
+}
+
+uint32_t GetInstanceCount() {
+    return (uint32_t)context.scene.bvh.order.size();
+}
+
+static void ComputeInstanceBounds(Scene *scene, InstanceHandle handle) {
+    const Instance &instance = scene->instances[handle];
+    const VoxelModel &model = scene->models[instance.model];
+    glm::vec3 size = glm::vec3(model.max - model.min);
+
+    InstanceBounds &bounds = scene->bounds[handle];
+    bounds.min = glm::vec3(FLT_MAX);
+    bounds.max = glm::vec3(-FLT_MAX);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = size * glm::vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        glm::vec3 world = glm::vec3(instance.transform * glm::vec4(corner, 1.0f));
+        bounds.min = glm::min(bounds.min, world);
+        bounds.max = glm::max(bounds.max, world);
+    }
+}
+
+// Bounds are per handle, so they stay valid while the build permutes order.
+static void UpdateInstanceBounds(Scene *scene) {
+    ParallelFor((uint32_t)scene->bvh.order.size(), InstanceBoundsBatch, [scene](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t slot = begin; slot < end; slot++) {
+            ComputeInstanceBounds(scene, scene->bvh.order[slot]);
+        }
+    });
+}
+
+// The GPU copy of each instance goes to its leaf slot.
+static void WriteGpuInstances(Scene *scene) {
+    scene->gpuInstances.resize(scene->bvh.order.size());
+
+    ParallelFor((uint32_t)scene->bvh.order.size(), InstanceBoundsBatch, [scene](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t slot = begin; slot < end; slot++) {
+            InstanceHandle handle = scene->bvh.order[slot];
+            const Instance &instance = scene->instances[handle];
+            const VoxelModel &model = scene->models[instance.model];
+            SceneInstance &gpu = scene->gpuInstances[slot];
+            gpu.worldToLocal = glm::inverse(instance.transform);
+            gpu.regionMin = glm::ivec4(model.min, (int32_t)handle);
+            gpu.regionMax = glm::ivec4(model.max, 0);
+        }
+    });
+}
+
+// boundsCurrent skips recomputing bounds a refit has just updated.
+static void BuildScene(Scene *scene, bool boundsCurrent) {
+    scene->bvh.order.clear();
+    for (InstanceHandle handle = 0; handle < (InstanceHandle)scene->instances.size(); handle++) {
+        if (scene->instances[handle].alive) {
+            scene->bvh.order.push_back(handle);
+        }
+    }
+
+    if (!boundsCurrent) {
+        UpdateInstanceBounds(scene);
+    }
+
+    BuildSceneBvh(&scene->bvh, scene->bounds);
+    WriteGpuInstances(scene);
+}
+
+static void RefitScene(Scene *scene) {
+    UpdateInstanceBounds(scene);
+
+    if (!RefitSceneBvh(&scene->bvh, scene->bounds)) {
+        BuildScene(scene, true);
+        return;
+    }
+
+    WriteGpuInstances(scene);
+}
+
+// Grows by doubling; the replaced buffer may still be read by the frame that last used this slot.
+static bool ReserveMappedBuffer(MappedBuffer *buffer, uint32_t size) {
+    if (buffer->buffer.buffer != VK_NULL_HANDLE && buffer->buffer.size >= size) {
+        return true;
+    }
+
+    uint32_t capacity = std::max(size, buffer->buffer.size * 2);
+    if (buffer->buffer.buffer != VK_NULL_HANDLE) {
+        Buffer previous = buffer->buffer;
+        DeferDestroy([previous]() mutable {
+            vmaUnmapMemory(context.allocator, previous.alloc);
+            DestroyBuffer(&previous);
+        });
+        ReleaseBindlessBuffer(buffer->handle);
+    }
+
+    buffer->buffer = CreateBuffer(capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    buffer->mapped = nullptr;
+    buffer->handle = InvalidBindlessHandle;
+    if (buffer->buffer.buffer == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    if (vmaMapMemory(context.allocator, buffer->buffer.alloc, (void **)&buffer->mapped) != VK_SUCCESS) {
+        DestroyBuffer(&buffer->buffer);
+        return false;
+    }
+
+    buffer->handle = RegisterBindlessBuffer(buffer->buffer);
+    return true;
+}
+
+void UpdateScene(uint32_t slot, FrameConstants *constants) {
+    Scene &scene = context.scene;
+
+    scene.moved = scene.structureDirty || scene.transformsDirty;
+    if (scene.structureDirty) {
+        BuildScene(&scene, false);
+    } else if (scene.transformsDirty) {
+        RefitScene(&scene);
+    }
+    if (scene.moved) {
+        scene.version++;
+    }
+    scene.structureDirty = false;
+    scene.transformsDirty = false;
+
+    constants->instanceCount = 0;
+    uint32_t instanceCount = (uint32_t)scene.bvh.order.size();
+    if (instanceCount == 0) {
+        return;
+    }
+
+    SceneFrame &frame = scene.frames[slot];
+    uint32_t nodeBytes = sizeof(SceneNode) * scene.bvh.nodeCount;
+    uint32_t instanceBytes = sizeof(SceneInstance) * instanceCount;
+    if (frame.version != scene.version || frame.nodes.mapped == nullptr) {
+        if (!ReserveMappedBuffer(&frame.nodes, nodeBytes) || !ReserveMappedBuffer(&frame.instances, instanceBytes)) {
+            return;
+        }
+
+        memcpy(frame.nodes.mapped, scene.bvh.nodes.data(), nodeBytes);
+        memcpy(frame.instances.mapped, scene.gpuInstances.data(), instanceBytes);
+        frame.version = scene.version;
+    }
+
+    constants->instanceCount = instanceCount;
+    constants->sceneNodes = frame.nodes.handle;
+    constants->sceneInstances = frame.instances.handle;
+}
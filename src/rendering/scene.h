@@ -0,0 +1,93 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "buffer.h"
+#include "bindless.h"
+#include "scenebvh.h"
+
+constexpr uint32_t InstanceBoundsBatch = 256;
+// 1 << MaxLodLevel in trace.glsl: the coarsest cells an LOD hit can return.
+constexpr int32_t VoxelModelAlignment = 8;
+
+using ModelHandle = uint32_t;
+using InstanceHandle = uint32_t;
+
+constexpr InstanceHandle InvalidInstanceHandle = UINT32_MAX;
+
+// A model is a box of the shared voxel grid, so all of its instances read the same storage, distance
+// field and occupancy pyramid. Boxes are widened to VoxelModelAlignment so LOD cells never mix in
+// voxels from outside the model.
+struct VoxelModel {
+    glm::ivec3 min;
+    glm::ivec3 max;
+};
+
+// The transform maps model space, where the model covers [0, max - min), to world space.
+struct Instance {
+    ModelHandle model;
+    glm::mat4 transform;
+    bool alive;
+};
+
+// std430 mirror of SceneInstance in scene.glsl. regionMin.w carries the instance handle back out of picking.
+struct SceneInstance {
+    glm::mat4 worldToLocal;
+    glm::ivec4 regionMin;
+    glm::ivec4 regionMax;
+};
+
+struct MappedBuffer {
+    Buffer buffer;
+    uint8_t *mapped;
+    BindlessHandle handle;
+};
+
+// Each frame in flight reads its own copy, rewritten when the scene version moves past it.
+struct SceneFrame {
+    MappedBuffer nodes;
+    MappedBuffer instances;
+    uint32_t version;
+};
+
+struct Scene {
+    std::vector<VoxelModel> models;
+    std::vector<Instance> instances;
+    std::vector<InstanceHandle> freeInstances;
+    std::vector<InstanceBounds> bounds;
+
+    // Built over live instance handles; gpuInstances follows its leaf order.
+    SceneBvh bvh;
+    std::vector<SceneInstance> gpuInstances;
+
+    bool structureDirty;
+    bool transformsDirty;
+    // Set for the frame that first sees a change, so every tile is marched again.
+    bool moved;
+    uint32_t version;
+
+    std::vector<SceneFrame> frames;
+};
+
+struct FrameConstants;
+enum Result : int;
+
+Result CreateScene(Scene *scene);
+void DestroyScene(Scene *scene);
+
+// Not thread safe; call from the thread that renders. CreateInstance returns InvalidInstanceHandle
+// for an unknown model, and stale or invalid instance handles are ignored.
+ModelHandle CreateVoxelModel(glm::ivec3 min, glm::ivec3 max);
+InstanceHandle CreateInstance(ModelHandle model, const glm::mat4 &transform);
+void SetInstanceTransform(InstanceHandle instance, const glm::mat4 &transform);
+void DestroyInstance(InstanceHandle instance);
+uint32_t GetInstanceCount();
+
+// Rebuilds or refits the BVH if instances changed, then points the frame constants at this slot's copy.
+void UpdateScene(uint32_t slot, FrameConstants *constants);
+
+#endif // SCENE_H
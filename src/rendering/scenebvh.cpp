@@ -0,0 +1,107 @@
+#include "scenebvh.h"
+
+#include "../core/jobs.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+static float SurfaceArea(glm::vec3 min, glm::vec3 max) {
+    glm::vec3 extent = glm::max(max - min, glm::vec3(0.0f));
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+static glm::vec3 GetCentroid(const InstanceBounds &bounds) {
+    return 0.5f * (bounds.min + bounds.max);
+}
+
+// Median split on the widest centroid axis. Children are allocated in pairs from an atomic counter,
+// so a child's index is always greater than its parent's; refits rely on that ordering.
+static void BuildNode(SceneBvh *bvh, const std::vector<InstanceBounds> *bounds, uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth) {
+    SceneNode &node = bvh->nodes[nodeIndex];
+
+    glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+    node.min = glm::vec3(FLT_MAX);
+    node.max = glm::vec3(-FLT_MAX);
+    for (uint32_t i = begin; i < end; i++) {
+        const InstanceBounds &item = (*bounds)[bvh->order[i]];
+        node.min = glm::min(node.min, item.min);
+        node.max = glm::max(node.max, item.max);
+
+        glm::vec3 centroid = GetCentroid(item);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    if (end - begin <= MaxLeafInstances) {
+        node.first = begin;
+        node.count = end - begin;
+
+        uint32_t deepest = bvh->depth;
+        while (depth > deepest && !bvh->depth.compare_exchange_weak(deepest, depth)) {}
+        return;
+    }
+
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(bvh->order.begin() + begin, bvh->order.begin() + mid, bvh->order.begin() + end,
+        [bounds, axis](uint32_t a, uint32_t b) { return GetCentroid((*bounds)[a])[axis] < GetCentroid((*bounds)[b])[axis]; });
+
+    uint32_t left = bvh->nodeCount.fetch_add(2);
+    node.first = left;
+    node.count = 0;
+
+    if (end - begin > ParallelBuildInstances) {
+        ScheduleJob([bvh, bounds, left, begin, mid, depth](uint32_t) {
+            BuildNode(bvh, bounds, left, begin, mid, depth + 1);
+        });
+    } else {
+        BuildNode(bvh, bounds, left, begin, mid, depth + 1);
+    }
+    BuildNode(bvh, bounds, left + 1, mid, end, depth + 1);
+}
+
+void BuildSceneBvh(SceneBvh *bvh, const std::vector<InstanceBounds> &bounds) {
+    uint32_t count = (uint32_t)bvh->order.size();
+    bvh->nodeCount = 0;
+    if (count == 0) {
+        return;
+    }
+
+    bvh->nodes.resize(2 * count - 1);
+    bvh->nodeCount = 1;
+    bvh->depth = 0;
+    BuildNode(bvh, &bounds, 0, 0, count, 0);
+    WaitForJobs();
+    // Median splits keep the depth near log2(count / MaxLeafInstances), far inside the stack.
+    assert(bvh->depth < SceneStackSize);
+
+    bvh->builtArea = SurfaceArea(bvh->nodes[0].min, bvh->nodes[0].max);
+}
+
+bool RefitSceneBvh(SceneBvh *bvh, const std::vector<InstanceBounds> &bounds) {
+    if (bvh->nodeCount == 0) {
+        return true;
+    }
+
+    for (uint32_t i = bvh->nodeCount; i-- > 0;) {
+        SceneNode &node = bvh->nodes[i];
+        if (node.count > 0) {
+            node.min = glm::vec3(FLT_MAX);
+            node.max = glm::vec3(-FLT_MAX);
+            for (uint32_t slot = node.first; slot < node.first + node.count; slot++) {
+                node.min = glm::min(node.min, bounds[bvh->order[slot]].min);
+                node.max = glm::max(node.max, bounds[bvh->order[slot]].max);
+            }
+        } else {
+            const SceneNode &left = bvh->nodes[node.first];
+            const SceneNode &right = bvh->nodes[node.first + 1];
+            node.min = glm::min(left.min, right.min);
+            node.max = glm::max(left.max, right.max);
+        }
+    }
+
+    return SurfaceArea(bvh->nodes[0].min, bvh->nodes[0].max) <= bvh->builtArea * BvhRebuildGrowth;
+}
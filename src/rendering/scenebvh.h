@@ -0,0 +1,48 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t MaxLeafInstances = 4;
+// Subtrees with more instances than this are built as separate jobs.
+constexpr uint32_t ParallelBuildInstances = 1024;
+// A refit that grows the root's surface area past this factor of the last build's triggers a rebuild.
+constexpr float BvhRebuildGrowth = 2.0f;
+// Mirrors scene.glsl; traceScene's stack overflows on trees deeper than SceneStackSize - 1 levels.
+constexpr uint32_t SceneStackSize = 32;
+
+struct InstanceBounds {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// std430 mirror of SceneNode in scene.glsl. Interior nodes have count 0 and their children at first
+// and first + 1; leaves cover order[first, first + count).
+struct SceneNode {
+    glm::vec3 min;
+    uint32_t first;
+    glm::vec3 max;
+    uint32_t count;
+};
+
+struct SceneBvh {
+    // Indices into the bounds the tree was built over, in leaf order.
+    std::vector<uint32_t> order;
+    std::vector<SceneNode> nodes;
+    std::atomic<uint32_t> nodeCount;
+    std::atomic<uint32_t> depth;
+    float builtArea;
+};
+
+// Builds over the indices already in order, permuting them into leaf order. Large subtrees run on the
+// job system, so call it from the thread that drives it.
+void BuildSceneBvh(SceneBvh *bvh, const std::vector<InstanceBounds> &bounds);
+// Keeps the tree and recomputes its bounds bottom up. Returns false once the tree has loosened
+// enough that traversal would suffer, and it should be rebuilt instead.
+bool RefitSceneBvh(SceneBvh *bvh, const std::vector<InstanceBounds> &bounds);
+
+#endif // SCENEBVH_H
@@ -3,6 +3,8 @@
 #include "context.h"
 #include "vkutil.h"
 
+#include <SDL2/SDL_vulkan.h>
+
 static VkSurfaceFormatKHR GetSwapchainSurfaceFormat() {
     uint32_t formatCount = 0;
     vkGetPhysicalDeviceSurfaceFormatsKHR(context.physicalDevice, context.surface, &formatCount, nullptr);
@@ -33,14 +35,39 @@ static VkPresentModeKHR GetSwapchainPresentMode(bool vsync) {
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
-Result CreateSwapchain(Swapchain *swapchain, bool vsync) {
+static VkExtent2D GetSwapchainExtent(const VkSurfaceCapabilitiesKHR &caps) {
+    if (caps.currentExtent.width != UINT32_MAX) {
+        return caps.currentExtent;
+    }
+
+    int width = 0, height = 0;
+    SDL_Vulkan_GetDrawableSize(context.window, &width, &height);
+
+    VkExtent2D extent = {};
+    extent.width = glm::clamp((uint32_t)width, caps.minImageExtent.width, caps.maxImageExtent.width);
+    extent.height = glm::clamp((uint32_t)height, caps.minImageExtent.height, caps.maxImageExtent.height);
+    return extent;
+}
+
+Result CreateSwapchain(Swapchain *swapchain, bool vsync, bool lowLatency, VkSwapchainKHR oldSwapchain) {
+    *swapchain = {};
     swapchain->vsync = vsync;
+    swapchain->lowLatency = lowLatency;
 
     VkSurfaceCapabilitiesKHR caps;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(context.physicalDevice, context.surface, &caps);
 
-    swapchain->imageCount = caps.minImageCount + 1;
-    swapchain->extent = caps.currentExtent;
+    swapchain->extent = GetSwapchainExtent(caps);
+    if (swapchain->extent.width == 0 || swapchain->extent.height == 0) {
+        return Success;
+    }
+
+    // Every queued image is a frame of latency; the low latency mode keeps the queue as short as the
+    // surface allows.
+    swapchain->imageCount = lowLatency ? glm::max(caps.minImageCount, 2u) : caps.minImageCount + 1;
+    if (caps.maxImageCount > 0) {
+        swapchain->imageCount = glm::min(swapchain->imageCount, caps.maxImageCount);
+    }
 
     swapchain->surfaceFormat = GetSwapchainSurfaceFormat();
     swapchain->presentMode = GetSwapchainPresentMode(vsync);
@@ -52,6 +79,8 @@ Result CreateSwapchain(Swapchain *swapchain, bool vsync) {
     swapchainInfo.imageColorSpace = swapchain->surfaceFormat.colorSpace;
     swapchainInfo.imageExtent = swapchain->extent;
     swapchainInfo.presentMode = swapchain->presentMode;
+    swapchainInfo.preTransform = caps.currentTransform;
+    swapchainInfo.oldSwapchain = oldSwapchain;
 
     VkCheck(vkCreateSwapchainKHR(context.device, &swapchainInfo, nullptr, &swapchain->swapchain));
 
@@ -76,5 +105,11 @@ Result CreateSwapchain(Swapchain *swapchain, bool vsync) {
 }
 
 void SwapchainDestroy(Swapchain *swapchain) {
+    for (uint32_t i = 0; i < swapchain->imageViews.size(); i++) {
+        vkDestroyImageView(context.device, swapchain->imageViews[i], nullptr);
+        vkDestroySemaphore(context.device, swapchain->submitReadySemaphores[i], nullptr);
+    }
 
+    vkDestroySwapchainKHR(context.device, swapchain->swapchain, nullptr);
+    *swapchain = {};
 }
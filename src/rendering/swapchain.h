@@ -14,6 +14,10 @@ struct Swapchain {
     uint32_t imageCount;
 
     bool vsync;
+    bool lowLatency;
+
+    // Id of the last present, tagged through VK_KHR_present_id when present wait is enabled.
+    uint64_t presentId;
 
     std::vector<VkImageView> imageViews;
     std::vector<VkImage> images;
@@ -21,8 +25,10 @@ struct Swapchain {
     std::vector<VkSemaphore> submitReadySemaphores;
 };
 
-enum Result;
+enum Result : int;
 
-Result CreateSwapchain(Swapchain *swapchain, bool vsync);
+// Returns Success with a null swapchain while the surface has no area, e.g. when minimized.
+Result CreateSwapchain(Swapchain *swapchain, bool vsync, bool lowLatency, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+void SwapchainDestroy(Swapchain *swapchain);
 
 #endif // SWAPCHAIN_H
\ No newline at end of file
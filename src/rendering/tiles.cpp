@@ -0,0 +1,63 @@
+#include "tiles.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+constexpr uint32_t MarkGroupSize = 8;
+
+Result CreateTilePass(TilePass *pass, uint32_t width, uint32_t height) {
+    pass->markPipeline = CreateComputePipeline("../../res/shaders/tiles.comp");
+    pass->tileList = CreateIndirectDispatch(1, 0);
+    pass->regions = CreateBuffer(sizeof(DirtyRegion) * MaxDirtyRegions, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+    BindStorageBuffer(pass->markPipeline.set, 1, pass->regions);
+    BindFrameConstants(pass->markPipeline.set, 2, context.frameConstants);
+
+    return ResizeTilePass(pass, width, height);
+}
+
+Result ResizeTilePass(TilePass *pass, uint32_t width, uint32_t height) {
+    pass->tilesX = GetGroupCount(width, TileSize);
+    pass->tilesY = GetGroupCount(height, TileSize);
+
+    ResizeIndirectDispatch(&pass->tileList, sizeof(uint32_t) * pass->tilesX * pass->tilesY);
+    BindStorageBuffer(pass->markPipeline.set, 0, pass->tileList.buffer);
+
+    return Success;
+}
+
+void DestroyTilePass(TilePass *pass) {
+    DestroyBuffer(&pass->regions);
+    DestroyIndirectDispatch(&pass->tileList);
+    DestroyPipeline(&pass->markPipeline);
+}
+
+void RecordTilePass(VkCommandBuffer cmd, TilePass *pass, TilePushConstants push, const std::vector<DirtyRegion> &regions) {
+    std::vector<DirtyRegion> merged = regions;
+    if (merged.size() > MaxDirtyRegions) {
+        DirtyRegion bounds = merged[0];
+        for (const auto &region : merged) {
+            bounds.min = glm::min(bounds.min, region.min);
+            bounds.max = glm::max(bounds.max, region.max);
+        }
+        merged = {bounds};
+    }
+
+    push.regionCount = (uint32_t)merged.size();
+    push.screenWidth = (int32_t)context.renderImage.width;
+    push.screenHeight = (int32_t)context.renderImage.height;
+
+    ResetIndirectCounts(cmd, &pass->tileList);
+
+    if (!merged.empty()) {
+        vkCmdUpdateBuffer(cmd, pass->regions.buffer, 0, sizeof(DirtyRegion) * merged.size(), merged.data());
+        BufferBarrier(cmd, pass->regions, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pass->markPipeline.pipeline);
+    BindDescriptorSets(cmd, pass->markPipeline);
+    vkCmdPushConstants(cmd, pass->markPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, GetGroupCount(pass->tilesX, MarkGroupSize), GetGroupCount(pass->tilesY, MarkGroupSize), 1);
+
+    ResolveIndirectArgs(cmd, &pass->tileList, 1);
+}
@@ -0,0 +1,50 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "buffer.h"
+#include "dispatch.h"
+#include "pipeline.h"
+
+constexpr uint32_t TileSize = 16;
+constexpr uint32_t MaxDirtyRegions = 16;
+
+struct DirtyRegion {
+    glm::ivec4 min;
+    glm::ivec4 max;
+};
+
+struct TilePass {
+    Pipeline markPipeline;
+
+    // One workgroup per dirty tile; the payload holds packed tile coordinates.
+    IndirectDispatch tileList;
+    Buffer regions;
+
+    uint32_t tilesX;
+    uint32_t tilesY;
+};
+
+struct TilePushConstants {
+    uint32_t regionCount;
+    int32_t invalidateAll;
+    int32_t screenWidth;
+    int32_t screenHeight;
+
+    // Only tiles whose rows fall in [bandMin, bandMax) are marked.
+    int32_t bandMin;
+    int32_t bandMax;
+};
+
+enum Result : int;
+
+Result CreateTilePass(TilePass *pass, uint32_t width, uint32_t height);
+Result ResizeTilePass(TilePass *pass, uint32_t width, uint32_t height);
+void DestroyTilePass(TilePass *pass);
+void RecordTilePass(VkCommandBuffer cmd, TilePass *pass, TilePushConstants push, const std::vector<DirtyRegion> &regions);
+
+#endif // TILES_H
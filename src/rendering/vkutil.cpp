@@ -78,13 +78,13 @@ VkSwapchainCreateInfoKHR GetSwapchainCreateInfo() {
     return info;
 }
 
-VkImageViewCreateInfo GetImageViewCreateInfo(VkImage image, VkFormat format, VkImageAspectFlags aspectMask) {
+VkImageViewCreateInfo GetImageViewCreateInfo(VkImage image, VkFormat format, VkImageAspectFlags aspectMask, VkImageViewType viewType) {
     VkImageViewCreateInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     info.pNext = nullptr;
     info.flags = 0;
     info.image = image;
-    info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    info.viewType = viewType;
     info.format = format;
     info.components.r = VK_COMPONENT_SWIZZLE_R;
     info.components.g = VK_COMPONENT_SWIZZLE_G;
@@ -433,6 +433,22 @@ VkDescriptorSetAllocateInfo GetDescriptorSetAllocateInfo(VkDescriptorPool pool,
     return info;
 }
 
+VkWriteDescriptorSet GetWriteDescriptorSet(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkDescriptorBufferInfo *bufferInfo, VkDescriptorImageInfo *imageInfo) {
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = nullptr;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pImageInfo = imageInfo;
+    write.pBufferInfo = bufferInfo;
+    write.pTexelBufferView = nullptr;
+
+    return write;
+}
+
 VkSamplerCreateInfo GetSamplerCreateInfo() {
     VkSamplerCreateInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -457,6 +473,16 @@ VkSamplerCreateInfo GetSamplerCreateInfo() {
     return info;
 }
 
+void GlobalBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
 VkSemaphore CreateSemaphore() {
     VkSemaphoreCreateInfo info = GetSemaphoreCreateInfo();
     VkSemaphore semaphore;
@@ -477,19 +503,3 @@ VkCommandBuffer AllocateCommandBuffer() {
     vkAllocateCommandBuffers(context.device, &info, &cmd);
     return cmd;
 }
-
-VkCommandBuffer BeginSingleUseCmd() {
-    VkCommandBuffer cmd = AllocateCommandBuffer();
-    VkCommandBufferBeginInfo info = GetCommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-    vkBeginCommandBuffer(cmd, &info);
-
-    return cmd;
-}
-
-void EndSingleUseCmd(VkCommandBuffer cmd) {
-    vkEndCommandBuffer(cmd);
-
-    VkSubmitInfo info = GetSubmitInfo(&cmd, {}, {}, {});
-    vkQueueSubmit(context.queue, 1, &info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(context.queue);
-}
\ No newline at end of file
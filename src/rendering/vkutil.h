@@ -11,7 +11,7 @@ VkInstanceCreateInfo GetInstanceCreateInfo(VkApplicationInfo *appInfo, const std
 VkDeviceCreateInfo GetDeviceCreateInfo(const std::vector<VkDeviceQueueCreateInfo> &queueInfos, const std::vector<const char *> &extensions);
 VkDeviceQueueCreateInfo GetDeviceQueueCreateInfo(uint32_t queueFamilyIndex, uint32_t count);
 VkSwapchainCreateInfoKHR GetSwapchainCreateInfo();
-VkImageViewCreateInfo GetImageViewCreateInfo(VkImage image, VkFormat format, VkImageAspectFlags aspectMask);
+VkImageViewCreateInfo GetImageViewCreateInfo(VkImage image, VkFormat format, VkImageAspectFlags aspectMask, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D);
 VkFenceCreateInfo GetFenceCreateInfo(VkFenceCreateFlags flags);
 VkSemaphoreCreateInfo GetSemaphoreCreateInfo();
 VkCommandPoolCreateInfo GetCommandPoolCreateInfo(VkCommandPoolCreateFlags flags, uint32_t familyIndex);
@@ -40,12 +40,12 @@ VkPipelineLayoutCreateInfo GetPipelineLayoutCreateInfo(const std::vector<VkDescr
 VkDescriptorPoolCreateInfo GetDescriptorPoolCreateInfo(uint32_t maxSets, const std::vector<VkDescriptorPoolSize> &poolSizes);
 VkDescriptorSetLayoutCreateInfo GetDescriptorsetLayoutCreatInfo(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
 VkDescriptorSetAllocateInfo GetDescriptorSetAllocateInfo(VkDescriptorPool pool, const std::vector<VkDescriptorSetLayout> &layouts);
+VkWriteDescriptorSet GetWriteDescriptorSet(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkDescriptorBufferInfo *bufferInfo, VkDescriptorImageInfo *imageInfo);
+
+void GlobalBarrier(VkCommandBuffer cmd, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
 
 VkSemaphore CreateSemaphore();
 VkFence CreateFence(VkFenceCreateFlags flags);
 VkCommandBuffer AllocateCommandBuffer();
 
-VkCommandBuffer BeginSingleUseCmd();
-void EndSingleUseCmd(VkCommandBuffer cmd);
-
 #endif // VK_UTIL
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "wavefront.h"
+
+#include "context.h"
+#include "vkutil.h"
+
+constexpr uint32_t RaySize = 16 * sizeof(float);
+constexpr uint32_t HitSize = 2 * sizeof(uint32_t);
+
+// Not every kernel declares every queue resource, and a set can't be written at a binding its
+// layout lacks.
+static void BindQueueResources(Pipeline &pipeline, WavefrontPass *pass) {
+    const Buffer *buffers[] = {&pass->queues.buffer, &pass->rays, &pass->hits, &pass->prefix, &pass->blockSums};
+    for (uint32_t binding = 0; binding < 5; binding++) {
+        if (HasBinding(pipeline, binding)) {
+            BindStorageBuffer(pipeline.set, binding, *buffers[binding]);
+        }
+    }
+
+    if (HasBinding(pipeline, 5)) {
+        BindStorageImage(pipeline.set, 5, pass->radiance);
+    }
+}
+
+static void Dispatch(VkCommandBuffer cmd, Pipeline &pipeline, const WavefrontPushConstants &push) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+    BindDescriptorSets(cmd, pipeline);
+    vkCmdPushConstants(cmd, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+}
+
+static void DispatchQueue(VkCommandBuffer cmd, Pipeline &pipeline, WavefrontPass *pass, const WavefrontPushConstants &push) {
+    Dispatch(cmd, pipeline, push);
+    DispatchIndirect(cmd, pass->queues, push.readQueue);
+}
+
+static void QueueBarrier(VkCommandBuffer cmd) {
+    GlobalBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+Result CreateWavefrontPass(WavefrontPass *pass, uint32_t width, uint32_t height) {
+    std::vector<std::string> groupDefines = GetWavefrontShaderDefines();
+    std::vector<std::string> traceDefines = GetVoxelShaderDefines();
+    traceDefines.insert(traceDefines.end(), groupDefines.begin(), groupDefines.end());
+
+    pass->raygenPipeline = CreateComputePipeline("../../res/shaders/wf_raygen.comp", groupDefines);
+    pass->tracePipeline = CreateComputePipeline("../../res/shaders/wf_trace.comp", traceDefines);
+    pass->shadePipeline = CreateComputePipeline("../../res/shaders/wf_shade.comp", groupDefines);
+    pass->scanBlocksPipeline = CreateComputePipeline("../../res/shaders/wf_scan_blocks.comp", groupDefines);
+    pass->scanSumsPipeline = CreateComputePipeline("../../res/shaders/wf_scan_sums.comp", groupDefines);
+    pass->compactPipeline = CreateComputePipeline("../../res/shaders/wf_compact.comp", groupDefines);
+    pass->resolvePipeline = CreateComputePipeline("../../res/shaders/wf_resolve.comp", groupDefines);
+
+    pass->queues = CreateIndirectDispatch(2, 0);
+
+    BindStorageBuffer(pass->tracePipeline.set, 7, context.distanceField.distances);
+    BindStorageBuffer(pass->tracePipeline.set, 8, context.occupancyPyramid.cells);
+    BindFrameConstants(pass->raygenPipeline.set, 11, context.frameConstants);
+
+    return ResizeWavefrontPass(pass, width, height);
+}
+
+Result ResizeWavefrontPass(WavefrontPass *pass, uint32_t width, uint32_t height) {
+    pass->capacity = width * height;
+    uint32_t blockCount = GetGroupCount(pass->capacity, GetWavefrontGroupSize());
+
+    for (Buffer *buffer : {&pass->rays, &pass->hits, &pass->prefix, &pass->blockSums}) {
+        DestroyBuffer(buffer);
+    }
+    DestroyImage(&pass->radiance);
+
+    pass->rays = CreateBuffer(2 * RaySize * pass->capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    pass->hits = CreateBuffer(HitSize * pass->capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    pass->prefix = CreateBuffer(sizeof(uint32_t) * pass->capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    pass->blockSums = CreateBuffer(sizeof(uint32_t) * blockCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    pass->radiance = CreateImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, width, height);
+
+    for (Pipeline *pipeline : {&pass->raygenPipeline, &pass->tracePipeline, &pass->shadePipeline, &pass->scanBlocksPipeline, &pass->scanSumsPipeline, &pass->compactPipeline, &pass->resolvePipeline}) {
+        BindQueueResources(*pipeline, pass);
+    }
+
+    BindStorageImage(pass->resolvePipeline.set, 10, context.renderImage);
+
+    VkCommandBuffer cmd = BeginSingleUseCmd();
+    SetImageLayout(cmd, pass->radiance, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    EndSingleUseCmd(cmd);
+
+    return Success;
+}
+
+void DestroyWavefrontPass(WavefrontPass *pass) {
+    for (Buffer *buffer : {&pass->rays, &pass->hits, &pass->prefix, &pass->blockSums}) {
+        DestroyBuffer(buffer);
+    }
+    DestroyImage(&pass->radiance);
+    DestroyIndirectDispatch(&pass->queues);
+
+    for (Pipeline *pipeline : {&pass->raygenPipeline, &pass->tracePipeline, &pass->shadePipeline, &pass->scanBlocksPipeline, &pass->scanSumsPipeline, &pass->compactPipeline, &pass->resolvePipeline}) {
+        DestroyPipeline(pipeline);
+    }
+}
+
+void BindWavefrontVoxels(WavefrontPass *pass) {
+    BindVoxelStorage(pass->tracePipeline.set, 6);
+}
+
+void RecordWavefrontPass(VkCommandBuffer cmd, WavefrontPass *pass, WavefrontPushConstants push) {
+    uint32_t width = context.renderImage.width;
+    uint32_t height = context.renderImage.height;
+
+    push.readQueue = 0;
+    push.capacity = pass->capacity;
+
+    SetIndirectCount(cmd, &pass->queues, 0, pass->capacity);
+    ResolveIndirectArgs(cmd, &pass->queues, GetWavefrontGroupSize());
+
+    Dispatch(cmd, pass->raygenPipeline, push);
+    vkCmdDispatch(cmd, GetGroupCount(width, 16), GetGroupCount(height, 16), 1);
+    QueueBarrier(cmd);
+
+    for (uint32_t bounce = 0; bounce < push.maxBounces; bounce++) {
+        push.bounce = bounce;
+
+        DispatchQueue(cmd, pass->tracePipeline, pass, push);
+        QueueBarrier(cmd);
+
+        DispatchQueue(cmd, pass->shadePipeline, pass, push);
+        QueueBarrier(cmd);
+
+        if (bounce + 1 == push.maxBounces) {
+            break;
+        }
+
+        DispatchQueue(cmd, pass->scanBlocksPipeline, pass, push);
+        QueueBarrier(cmd);
+
+        Dispatch(cmd, pass->scanSumsPipeline, push);
+        vkCmdDispatch(cmd, 1, 1, 1);
+        ResolveIndirectArgs(cmd, &pass->queues, GetWavefrontGroupSize());
+
+        DispatchQueue(cmd, pass->compactPipeline, pass, push);
+        QueueBarrier(cmd);
+
+        push.readQueue = 1 - push.readQueue;
+    }
+
+    Dispatch(cmd, pass->resolvePipeline, push);
+    vkCmdDispatch(cmd, GetGroupCount(width, 16), GetGroupCount(height, 16), 1);
+}
@@ -0,0 +1,50 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <Volk/volk.h>
+
+#include "buffer.h"
+#include "dispatch.h"
+#include "image.h"
+#include "pipeline.h"
+
+struct WavefrontPass {
+    Pipeline raygenPipeline;
+    Pipeline tracePipeline;
+    Pipeline shadePipeline;
+    Pipeline scanBlocksPipeline;
+    Pipeline scanSumsPipeline;
+    Pipeline compactPipeline;
+    Pipeline resolvePipeline;
+
+    IndirectDispatch queues;
+    Buffer rays;
+    Buffer hits;
+    Buffer prefix;
+    Buffer blockSums;
+    Image radiance;
+
+    uint32_t capacity;
+};
+
+struct WavefrontPushConstants {
+    uint32_t frameIndex;
+    uint32_t readQueue;
+    uint32_t bounce;
+    uint32_t maxBounces;
+    uint32_t capacity;
+    int32_t marchMode;
+    uint32_t palette;
+    uint64_t voxelAddress;
+};
+
+enum Result : int;
+
+Result CreateWavefrontPass(WavefrontPass *pass, uint32_t width, uint32_t height);
+// Recreates the per-pixel queues and rebinds context.renderImage. Frames using them must have retired.
+Result ResizeWavefrontPass(WavefrontPass *pass, uint32_t width, uint32_t height);
+void DestroyWavefrontPass(WavefrontPass *pass);
+void BindWavefrontVoxels(WavefrontPass *pass);
+void RecordWavefrontPass(VkCommandBuffer cmd, WavefrontPass *pass, WavefrontPushConstants push);
+
+#endif // WAVEFRONT_H
@@ -0,0 +1,161 @@
+#include "world.h"
+
+#include "../core/jobs.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
+
+static VoxelWorld world;
+
+static size_t GetIndex(glm::ivec3 pos) {
+    return pos.x + (size_t)pos.y * world.size.x + (size_t)pos.z * world.size.x * world.size.y;
+}
+
+static bool InsideWorld(glm::ivec3 pos) {
+    return glm::all(glm::greaterThanEqual(pos, glm::ivec3(0))) && glm::all(glm::lessThan(pos, world.size));
+}
+
+void SetWorldVoxels(glm::ivec3 size, const std::vector<int> &voxels) {
+    std::unique_lock<std::shared_mutex> lock(world.mutex);
+    world.size = size;
+    world.voxels = voxels;
+}
+
+// Takes the full-grid data that was uploaded and copies only the updated box.
+void UpdateWorldVoxels(const std::vector<int> &voxels, glm::ivec3 min, glm::ivec3 max) {
+    std::unique_lock<std::shared_mutex> lock(world.mutex);
+    min = glm::max(min, glm::ivec3(0));
+    max = glm::min(max, world.size);
+
+    for (int z = min.z; z < max.z; z++) {
+        for (int y = min.y; y < max.y; y++) {
+            size_t row = GetIndex(glm::ivec3(min.x, y, z));
+            std::copy(voxels.begin() + row, voxels.begin() + row + (max.x - min.x), world.voxels.begin() + row);
+        }
+    }
+}
+
+int GetWorldVoxel(glm::ivec3 pos) {
+    std::shared_lock<std::shared_mutex> lock(world.mutex);
+    return InsideWorld(pos) ? world.voxels[GetIndex(pos)] : 0;
+}
+
+// Amanatides-Woo traversal, clipped to the grid first. The caller holds the lock.
+static RayHit CastRayLocked(const RayQuery &ray) {
+    RayHit hit = {};
+
+    // Near-zero components don't step at all, and keep their sign so the slab test stays on the
+    // right side of the grid.
+    glm::vec3 invDir;
+    glm::ivec3 step;
+    for (int i = 0; i < 3; i++) {
+        bool moving = glm::abs(ray.dir[i]) > 1e-6f;
+        invDir[i] = moving ? 1.0f / ray.dir[i] : std::copysign(FLT_MAX, ray.dir[i]);
+        step[i] = moving ? (ray.dir[i] > 0.0f ? 1 : -1) : 0;
+    }
+
+    glm::vec3 t0 = -ray.origin * invDir;
+    glm::vec3 t1 = (glm::vec3(world.size) - ray.origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+    float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, ray.maxDistance));
+    if (tEnter > tExit || world.voxels.empty()) {
+        return hit;
+    }
+
+    glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(ray.origin + ray.dir * tEnter)), glm::ivec3(0), world.size - 1);
+    glm::vec3 tDelta = glm::abs(invDir);
+    glm::vec3 tNext;
+    for (int i = 0; i < 3; i++) {
+        float boundary = (float)(cell[i] + (step[i] > 0 ? 1 : 0));
+        tNext[i] = step[i] != 0 ? (boundary - ray.origin[i]) * invDir[i] : FLT_MAX;
+    }
+
+    glm::ivec3 normal(0);
+    if (tEnter > 0.0f) {
+        int axis = tNear.x > tNear.y ? (tNear.x > tNear.z ? 0 : 2) : (tNear.y > tNear.z ? 1 : 2);
+        normal[axis] = -step[axis];
+    }
+
+    float t = tEnter;
+    while (t <= tExit) {
+        int material = world.voxels[GetIndex(cell)];
+        if (material != 0) {
+            hit.hit = true;
+            hit.distance = t;
+            hit.voxel = cell;
+            hit.normal = normal;
+            hit.material = material;
+            return hit;
+        }
+
+        int axis = tNext.x < tNext.y ? (tNext.x < tNext.z ? 0 : 2) : (tNext.y < tNext.z ? 1 : 2);
+        t = tNext[axis];
+        cell[axis] += step[axis];
+        tNext[axis] += tDelta[axis];
+        normal = glm::ivec3(0);
+        normal[axis] = -step[axis];
+
+        if (!InsideWorld(cell)) {
+            break;
+        }
+    }
+
+    return hit;
+}
+
+static bool OverlapBoxLocked(const BoxQuery &box) {
+    glm::ivec3 min = glm::max(glm::ivec3(glm::floor(box.min)), glm::ivec3(0));
+    glm::ivec3 max = glm::min(glm::ivec3(glm::ceil(box.max)), world.size);
+    if (world.voxels.empty()) {
+        return false;
+    }
+
+    for (int z = min.z; z < max.z; z++) {
+        for (int y = min.y; y < max.y; y++) {
+            size_t row = GetIndex(glm::ivec3(0, y, z));
+            for (int x = min.x; x < max.x; x++) {
+                if (world.voxels[row + x] != 0) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+RayHit CastRay(const RayQuery &ray) {
+    std::shared_lock<std::shared_mutex> lock(world.mutex);
+    return CastRayLocked(ray);
+}
+
+bool OverlapBox(const BoxQuery &box) {
+    std::shared_lock<std::shared_mutex> lock(world.mutex);
+    return OverlapBoxLocked(box);
+}
+
+void CastRays(const std::vector<RayQuery> &rays, std::vector<RayHit> &hits) {
+    hits.resize(rays.size());
+
+    std::shared_lock<std::shared_mutex> lock(world.mutex);
+    ParallelFor((uint32_t)rays.size(), QueryBatchSize, [&rays, &hits](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t i = begin; i < end; i++) {
+            hits[i] = CastRayLocked(rays[i]);
+        }
+    });
+}
+
+void OverlapBoxes(const std::vector<BoxQuery> &boxes, std::vector<uint8_t> &overlaps) {
+    overlaps.resize(boxes.size());
+
+    std::shared_lock<std::shared_mutex> lock(world.mutex);
+    ParallelFor((uint32_t)boxes.size(), QueryBatchSize, [&boxes, &overlaps](uint32_t begin, uint32_t end, uint32_t) {
+        for (uint32_t i = begin; i < end; i++) {
+            overlaps[i] = OverlapBoxLocked(boxes[i]) ? 1 : 0;
+        }
+    });
+}
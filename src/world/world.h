@@ -0,0 +1,56 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <glm/glm.hpp>
+
+#include <shared_mutex>
+#include <vector>
+
+// Queries of a batch are split into jobs of this many.
+constexpr uint32_t QueryBatchSize = 256;
+
+// CPU copy of the voxel grid the renderer draws, in grid space with one unit per voxel. Queries take
+// the lock shared, so any number of threads can query while writes wait for them.
+struct VoxelWorld {
+    glm::ivec3 size;
+    std::vector<int> voxels;
+    std::shared_mutex mutex;
+};
+
+struct RayQuery {
+    glm::vec3 origin;
+    glm::vec3 dir;
+    float maxDistance;
+};
+
+struct RayHit {
+    bool hit;
+    // Measured along dir, so a world unit when dir is normalised.
+    float distance;
+    glm::ivec3 voxel;
+    // Face the ray entered through; zero when it started inside the voxel.
+    glm::ivec3 normal;
+    int material;
+};
+
+struct BoxQuery {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Called by UploadVoxelData and UpdateVoxelData, so the CPU copy always matches what is uploaded.
+void SetWorldVoxels(glm::ivec3 size, const std::vector<int> &voxels);
+void UpdateWorldVoxels(const std::vector<int> &voxels, glm::ivec3 min, glm::ivec3 max);
+
+int GetWorldVoxel(glm::ivec3 pos);
+
+// Safe from any thread.
+RayHit CastRay(const RayQuery &ray);
+bool OverlapBox(const BoxQuery &box);
+
+// Batches run on the job system and hold the lock for the whole batch. Like WaitForJobs, call them
+// from the thread that drives the job system, never from inside a job.
+void CastRays(const std::vector<RayQuery> &rays, std::vector<RayHit> &hits);
+void OverlapBoxes(const std::vector<BoxQuery> &boxes, std::vector<uint8_t> &overlaps);
+
+#endif // WORLD_H
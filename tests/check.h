@@ -0,0 +1,20 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+// Each test is its own executable; main returns CheckFailures() so ctest sees any failed check.
+inline int &CheckFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            CheckFailures()++; \
+        } \
+    } while (0)
+
+#endif // CHECK_H
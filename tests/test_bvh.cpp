@@ -0,0 +1,174 @@
+#include "check.h"
+
+#include "../src/core/jobs.h"
+#include "../src/rendering/scenebvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+static std::vector<InstanceBounds> RandomBounds(uint32_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> extent(0.5f, 8.0f);
+
+    std::vector<InstanceBounds> bounds(count);
+    for (InstanceBounds &b : bounds) {
+        b.min = glm::vec3(position(rng), position(rng), position(rng));
+        b.max = b.min + glm::vec3(extent(rng), extent(rng), extent(rng));
+    }
+    return bounds;
+}
+
+static void BuildOver(SceneBvh *bvh, const std::vector<InstanceBounds> &bounds) {
+    bvh->order.clear();
+    for (uint32_t i = 0; i < (uint32_t)bounds.size(); i++) {
+        bvh->order.push_back(i);
+    }
+    BuildSceneBvh(bvh, bounds);
+}
+
+static bool Contains(const SceneNode &node, glm::vec3 min, glm::vec3 max) {
+    return glm::all(glm::lessThanEqual(node.min, min)) && glm::all(glm::greaterThanEqual(node.max, max));
+}
+
+// Walks the tree from the root, checking that every node is reached once, children come after their
+// parent, leaves cover every slot once and each node's bounds are exactly the union of what it holds.
+static void CheckTree(const SceneBvh &bvh, const std::vector<InstanceBounds> &bounds) {
+    uint32_t count = (uint32_t)bvh.order.size();
+    CHECK(bvh.nodeCount <= 2 * count - 1);
+
+    std::vector<uint32_t> nodeVisits(bvh.nodeCount, 0);
+    std::vector<uint32_t> slotVisits(count, 0);
+    std::vector<uint32_t> itemVisits(bounds.size(), 0);
+    for (uint32_t item : bvh.order) {
+        CHECK(item < bounds.size());
+        if (item < bounds.size()) {
+            itemVisits[item]++;
+        }
+    }
+
+    struct Entry {
+        uint32_t node;
+        uint32_t depth;
+    };
+    std::vector<Entry> stack = {{0, 0}};
+    uint32_t deepest = 0;
+    while (!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        CHECK(entry.node < bvh.nodeCount);
+        if (entry.node >= bvh.nodeCount) {
+            continue;
+        }
+        nodeVisits[entry.node]++;
+
+        const SceneNode &node = bvh.nodes[entry.node];
+        glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+        if (node.count > 0) {
+            CHECK(node.count <= MaxLeafInstances);
+            CHECK(node.first + node.count <= count);
+            deepest = entry.depth > deepest ? entry.depth : deepest;
+            for (uint32_t slot = node.first; slot < node.first + node.count && slot < count; slot++) {
+                slotVisits[slot]++;
+                min = glm::min(min, bounds[bvh.order[slot]].min);
+                max = glm::max(max, bounds[bvh.order[slot]].max);
+            }
+        } else {
+            CHECK(node.first > entry.node);
+            CHECK(node.first + 1 < bvh.nodeCount);
+            if (node.first > entry.node && node.first + 1 < bvh.nodeCount) {
+                const SceneNode &left = bvh.nodes[node.first];
+                const SceneNode &right = bvh.nodes[node.first + 1];
+                min = glm::min(left.min, right.min);
+                max = glm::max(left.max, right.max);
+                stack.push_back({node.first, entry.depth + 1});
+                stack.push_back({node.first + 1, entry.depth + 1});
+            }
+        }
+        CHECK(node.min == min);
+        CHECK(node.max == max);
+    }
+
+    CHECK(std::all_of(nodeVisits.begin(), nodeVisits.end(), [](uint32_t v) { return v == 1; }));
+    CHECK(std::all_of(slotVisits.begin(), slotVisits.end(), [](uint32_t v) { return v == 1; }));
+    CHECK(std::all_of(itemVisits.begin(), itemVisits.end(), [](uint32_t v) { return v == 1; }));
+    CHECK(deepest == bvh.depth);
+    CHECK(bvh.depth < SceneStackSize);
+}
+
+static void TestBuild() {
+    // Large enough that the top subtrees are built as jobs.
+    for (uint32_t count : {1u, 3u, MaxLeafInstances + 1, 100u, 4 * ParallelBuildInstances + 17}) {
+        std::vector<InstanceBounds> bounds = RandomBounds(count, count);
+        SceneBvh bvh;
+        BuildOver(&bvh, bounds);
+        CheckTree(bvh, bounds);
+
+        for (uint32_t item = 0; item < count; item++) {
+            CHECK(Contains(bvh.nodes[0], bounds[item].min, bounds[item].max));
+        }
+    }
+
+    SceneBvh empty;
+    BuildOver(&empty, {});
+    CHECK(empty.nodeCount == 0);
+    CHECK(RefitSceneBvh(&empty, {}));
+}
+
+static void TestBuildSkipsUnlistedItems() {
+    // The scene only lists live instances; the rest of bounds is stale and must be ignored.
+    std::vector<InstanceBounds> bounds = RandomBounds(200, 7);
+    SceneBvh bvh;
+    for (uint32_t i = 0; i < 200; i += 2) {
+        bvh.order.push_back(i);
+    }
+    BuildSceneBvh(&bvh, bounds);
+    CHECK(bvh.order.size() == 100);
+    for (uint32_t item : bvh.order) {
+        CHECK(item % 2 == 0);
+    }
+}
+
+static void TestRefit() {
+    std::vector<InstanceBounds> bounds = RandomBounds(3000, 11);
+    SceneBvh bvh;
+    BuildOver(&bvh, bounds);
+    std::vector<uint32_t> order = bvh.order;
+    uint32_t nodeCount = bvh.nodeCount;
+
+    // Small moves keep the tree; every node's bounds follow.
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+    for (InstanceBounds &b : bounds) {
+        glm::vec3 move(offset(rng), offset(rng), offset(rng));
+        b.min += move;
+        b.max += move;
+    }
+    CHECK(RefitSceneBvh(&bvh, bounds));
+    CHECK(bvh.order == order);
+    CHECK(bvh.nodeCount == nodeCount);
+    CheckTree(bvh, bounds);
+
+    // Spreading everything out loosens the tree past BvhRebuildGrowth.
+    for (InstanceBounds &b : bounds) {
+        b.min *= 4.0f;
+        b.max = b.min + glm::vec3(1.0f);
+    }
+    CHECK(!RefitSceneBvh(&bvh, bounds));
+
+    BuildOver(&bvh, bounds);
+    CheckTree(bvh, bounds);
+    CHECK(RefitSceneBvh(&bvh, bounds));
+}
+
+int main() {
+    InitializeJobSystem(3);
+
+    TestBuild();
+    TestBuildSkipsUnlistedItems();
+    TestRefit();
+
+    ShutdownJobSystem();
+    return CheckFailures() == 0 ? 0 : 1;
+}
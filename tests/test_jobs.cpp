@@ -0,0 +1,81 @@
+#include "check.h"
+
+#include "../src/core/jobs.h"
+
+#include <atomic>
+#include <vector>
+
+static void TestParallelForCoversRange() {
+    constexpr uint32_t Count = 1000;
+    std::vector<std::atomic<uint32_t>> visits(Count);
+    std::atomic<bool> badThread(false);
+
+    // A batch size that doesn't divide the count leaves a short last batch.
+    ParallelFor(Count, 64, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        if (threadIndex >= GetJobThreadCount() || end - begin > 64) {
+            badThread = true;
+        }
+        for (uint32_t i = begin; i < end; i++) {
+            visits[i]++;
+        }
+    });
+
+    CHECK(!badThread);
+    for (uint32_t i = 0; i < Count; i++) {
+        CHECK(visits[i] == 1);
+    }
+
+    bool ran = false;
+    ParallelFor(0, 16, [&](uint32_t, uint32_t, uint32_t) { ran = true; });
+    CHECK(!ran);
+}
+
+static void TestWaitCoversNestedJobs() {
+    std::atomic<uint32_t> finished(0);
+
+    // Like the BVH build, jobs schedule more jobs; WaitForJobs must not return before they finish.
+    for (uint32_t i = 0; i < 8; i++) {
+        ScheduleJob([&finished](uint32_t) {
+            for (uint32_t j = 0; j < 8; j++) {
+                ScheduleJob([&finished](uint32_t) { finished++; });
+            }
+            finished++;
+        });
+    }
+    WaitForJobs();
+
+    CHECK(finished == 8 + 8 * 8);
+}
+
+static void TestPerThreadSlots() {
+    std::vector<uint64_t> sums(GetJobThreadCount(), 0);
+
+    // Indexing by threadIndex needs no locking, as long as no two threads share an index.
+    ParallelFor(10000, 7, [&sums](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        for (uint32_t i = begin; i < end; i++) {
+            sums[threadIndex] += i;
+        }
+    });
+
+    uint64_t total = 0;
+    for (uint64_t sum : sums) {
+        total += sum;
+    }
+    CHECK(total == 10000ull * 9999ull / 2);
+}
+
+int main() {
+    // With no workers everything runs on the waiting thread.
+    for (uint32_t workers : {0u, 3u}) {
+        InitializeJobSystem(workers);
+        CHECK(GetJobThreadCount() == workers + 1);
+
+        TestParallelForCoversRange();
+        TestWaitCoversNestedJobs();
+        TestPerThreadSlots();
+
+        ShutdownJobSystem();
+    }
+
+    return CheckFailures() == 0 ? 0 : 1;
+}
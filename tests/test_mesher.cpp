@@ -0,0 +1,183 @@
+#include "check.h"
+
+#include "../src/rendering/chunkmesh.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+struct Quad {
+    glm::ivec3 corners[4];
+    uint32_t face;
+    uint32_t material;
+};
+
+static std::vector<Quad> Mesh(const std::vector<int> &data, glm::ivec3 gridSize, glm::ivec3 origin = glm::ivec3(0)) {
+    std::vector<uint32_t> vertices;
+    MeshChunk(data, gridSize, origin, vertices);
+    CHECK(vertices.size() % 4 == 0);
+
+    std::vector<Quad> quads(vertices.size() / 4);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        uint32_t vertex = vertices[i];
+        uint32_t mask = (1u << MeshPositionBits) - 1;
+        Quad &quad = quads[i / 4];
+        quad.corners[i % 4] = glm::ivec3(vertex & mask, (vertex >> MeshPositionBits) & mask, (vertex >> (2 * MeshPositionBits)) & mask);
+        quad.face = (vertex >> MeshFaceShift) & 7;
+        quad.material = vertex >> MeshMaterialShift;
+    }
+    return quads;
+}
+
+static glm::ivec3 FaceNormal(uint32_t face) {
+    glm::ivec3 normal(0);
+    normal[face >> 1] = (face & 1) ? -1 : 1;
+    return normal;
+}
+
+static glm::ivec3 Cross(glm::ivec3 a, glm::ivec3 b) {
+    return glm::ivec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+static int Area(const Quad &quad) {
+    glm::ivec3 n = Cross(quad.corners[1] - quad.corners[0], quad.corners[3] - quad.corners[0]);
+    return std::abs(n.x + n.y + n.z);
+}
+
+// Quads are flat, rectangular and wound counter-clockwise seen from outside.
+static void CheckQuadShape(const Quad &quad) {
+    CHECK(quad.face < 6);
+    CHECK(quad.corners[0] + quad.corners[2] == quad.corners[1] + quad.corners[3]);
+
+    glm::ivec3 normal = FaceNormal(quad.face);
+    glm::ivec3 n = Cross(quad.corners[1] - quad.corners[0], quad.corners[3] - quad.corners[0]);
+    CHECK(n.x * normal.x + n.y * normal.y + n.z * normal.z > 0);
+    CHECK(n - normal * (n.x * normal.x + n.y * normal.y + n.z * normal.z) == glm::ivec3(0));
+}
+
+static std::vector<int> EmptyGrid(glm::ivec3 size) {
+    return std::vector<int>(size.x * size.y * size.z, 0);
+}
+
+static void Set(std::vector<int> &data, glm::ivec3 size, glm::ivec3 pos, int material) {
+    data[pos.x + pos.y * size.x + pos.z * size.x * size.y] = material;
+}
+
+static void TestSingleVoxel() {
+    glm::ivec3 size(ChunkSize);
+    std::vector<int> data = EmptyGrid(size);
+    Set(data, size, glm::ivec3(1, 2, 3), 5);
+
+    std::vector<Quad> quads = Mesh(data, size);
+    CHECK(quads.size() == 6);
+
+    uint32_t faces = 0;
+    for (const Quad &quad : quads) {
+        CheckQuadShape(quad);
+        CHECK(quad.material == 5);
+        CHECK(Area(quad) == 1);
+        faces |= 1u << quad.face;
+
+        // The face lies on the voxel's side its normal points to.
+        glm::ivec3 normal = FaceNormal(quad.face);
+        int axis = quad.face >> 1;
+        int plane = glm::ivec3(1, 2, 3)[axis] + (normal[axis] > 0 ? 1 : 0);
+        for (const glm::ivec3 &corner : quad.corners) {
+            CHECK(corner[axis] == plane);
+            CHECK(glm::all(glm::greaterThanEqual(corner, glm::ivec3(1, 2, 3))));
+            CHECK(glm::all(glm::lessThanEqual(corner, glm::ivec3(2, 3, 4))));
+        }
+    }
+    CHECK(faces == 0x3f);
+}
+
+static void TestSolidChunkMerges() {
+    glm::ivec3 size(ChunkSize);
+    std::vector<int> data(size.x * size.y * size.z, 2);
+
+    std::vector<Quad> quads = Mesh(data, size);
+    CHECK(quads.size() == 6);
+    for (const Quad &quad : quads) {
+        CheckQuadShape(quad);
+        CHECK(Area(quad) == ChunkSize * ChunkSize);
+    }
+}
+
+static void TestMaterialsSplitQuads() {
+    glm::ivec3 size(ChunkSize);
+    std::vector<int> data = EmptyGrid(size);
+    Set(data, size, glm::ivec3(0, 0, 0), 1);
+    Set(data, size, glm::ivec3(1, 0, 0), 1);
+    CHECK(Mesh(data, size).size() == 6);
+
+    // The shared face stays hidden, but the sides no longer merge.
+    Set(data, size, glm::ivec3(1, 0, 0), 2);
+    std::vector<Quad> quads = Mesh(data, size);
+    CHECK(quads.size() == 10);
+    CHECK(std::none_of(quads.begin(), quads.end(), [](const Quad &quad) { return Area(quad) != 1; }));
+}
+
+static void TestNeighbourChunksHideFaces() {
+    glm::ivec3 size(2 * ChunkSize, ChunkSize, ChunkSize);
+    std::vector<int> data = EmptyGrid(size);
+    Set(data, size, glm::ivec3(ChunkSize - 1, 4, 4), 3);
+    Set(data, size, glm::ivec3(ChunkSize, 4, 4), 3);
+
+    std::vector<Quad> left = Mesh(data, size);
+    std::vector<Quad> right = Mesh(data, size, glm::ivec3(ChunkSize, 0, 0));
+    CHECK(left.size() == 5);
+    CHECK(right.size() == 5);
+    CHECK(std::none_of(left.begin(), left.end(), [](const Quad &quad) { return quad.face == 0; }));
+    CHECK(std::none_of(right.begin(), right.end(), [](const Quad &quad) { return quad.face == 1; }));
+
+    // Corners are chunk-local.
+    for (const Quad &quad : right) {
+        for (const glm::ivec3 &corner : quad.corners) {
+            CHECK(corner.x <= 1);
+        }
+    }
+
+    // Past the grid counts as empty, so the outer face shows.
+    std::vector<int> edge = EmptyGrid(glm::ivec3(ChunkSize));
+    Set(edge, glm::ivec3(ChunkSize), glm::ivec3(ChunkSize - 1, 0, 0), 1);
+    CHECK(Mesh(edge, glm::ivec3(ChunkSize)).size() == 6);
+}
+
+static void TestCheckerboardFillsBudget() {
+    glm::ivec3 size(ChunkSize);
+    std::vector<int> data = EmptyGrid(size);
+    for (int z = 0; z < ChunkSize; z++) {
+        for (int y = 0; y < ChunkSize; y++) {
+            for (int x = 0; x < ChunkSize; x++) {
+                if ((x + y + z) % 2 == 0) {
+                    Set(data, size, glm::ivec3(x, y, z), 1);
+                }
+            }
+        }
+    }
+
+    CHECK(Mesh(data, size).size() == MaxChunkQuads);
+}
+
+static void TestMaterialIsClamped() {
+    glm::ivec3 size(ChunkSize);
+    std::vector<int> data = EmptyGrid(size);
+    Set(data, size, glm::ivec3(0), (int)MaxMeshMaterial + 100);
+
+    std::vector<Quad> quads = Mesh(data, size);
+    CHECK(quads.size() == 6);
+    for (const Quad &quad : quads) {
+        CHECK(quad.material == MaxMeshMaterial);
+        CHECK(quad.face < 6);
+    }
+}
+
+int main() {
+    TestSingleVoxel();
+    TestSolidChunkMerges();
+    TestMaterialsSplitQuads();
+    TestNeighbourChunksHideFaces();
+    TestCheckerboardFillsBudget();
+    TestMaterialIsClamped();
+
+    return CheckFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include "check.h"
+
+#include "../src/core/jobs.h"
+#include "../src/world/world.h"
+
+#include <cfloat>
+#include <cmath>
+
+constexpr int Size = 8;
+
+static int Index(int x, int y, int z) {
+    return x + y * Size + z * Size * Size;
+}
+
+static bool Near(float a, float b) {
+    return std::fabs(a - b) < 1e-4f;
+}
+
+static RayHit Cast(glm::vec3 origin, glm::vec3 dir, float maxDistance = FLT_MAX) {
+    RayQuery ray = {origin, dir, maxDistance};
+    return CastRay(ray);
+}
+
+static void TestGetVoxel() {
+    CHECK(GetWorldVoxel(glm::ivec3(4, 2, 3)) == 7);
+    CHECK(GetWorldVoxel(glm::ivec3(3, 2, 3)) == 0);
+    CHECK(GetWorldVoxel(glm::ivec3(-1, 2, 3)) == 0);
+    CHECK(GetWorldVoxel(glm::ivec3(4, 2, Size)) == 0);
+}
+
+static void TestAxisRays() {
+    RayHit hit = Cast(glm::vec3(-2.0f, 2.5f, 3.5f), glm::vec3(1.0f, 0.0f, 0.0f));
+    CHECK(hit.hit);
+    CHECK(hit.voxel == glm::ivec3(4, 2, 3));
+    CHECK(hit.normal == glm::ivec3(-1, 0, 0));
+    CHECK(Near(hit.distance, 6.0f));
+    CHECK(hit.material == 7);
+
+    // Zero components must not step or push the slab test off the grid, whatever their sign.
+    hit = Cast(glm::vec3(4.5f, 2.5f, 10.0f), glm::vec3(-0.0f, 0.0f, -1.0f));
+    CHECK(hit.hit);
+    CHECK(hit.voxel == glm::ivec3(4, 2, 3));
+    CHECK(hit.normal == glm::ivec3(0, 0, 1));
+    CHECK(Near(hit.distance, 6.0f));
+
+    // Tiny negative components used to step backwards out of the grid on the first boundary.
+    hit = Cast(glm::vec3(4.5f, 2.5f, 10.0f), glm::vec3(-1e-8f, -1e-8f, -1.0f));
+    CHECK(hit.hit);
+    CHECK(hit.voxel == glm::ivec3(4, 2, 3));
+    CHECK(Near(hit.distance, 6.0f));
+
+    hit = Cast(glm::vec3(4.5f, -3.0f, 3.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+    CHECK(hit.hit);
+    CHECK(hit.normal == glm::ivec3(0, -1, 0));
+    CHECK(Near(hit.distance, 5.0f));
+
+    // Started inside the grid: the ray walks from its own cell.
+    hit = Cast(glm::vec3(0.5f, 2.5f, 3.5f), glm::vec3(1.0f, 0.0f, 0.0f));
+    CHECK(hit.hit);
+    CHECK(hit.normal == glm::ivec3(-1, 0, 0));
+    CHECK(Near(hit.distance, 3.5f));
+}
+
+static void TestStartInsideSolid() {
+    RayHit hit = Cast(glm::vec3(4.5f, 2.5f, 3.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+    CHECK(hit.hit);
+    CHECK(hit.voxel == glm::ivec3(4, 2, 3));
+    CHECK(hit.normal == glm::ivec3(0));
+    CHECK(Near(hit.distance, 0.0f));
+}
+
+static void TestDiagonalRay() {
+    glm::vec3 dir = glm::normalize(glm::vec3(0.0f, 1.0f, 1.0f));
+    RayHit hit = Cast(glm::vec3(4.5f, -2.0f, -0.5f), dir);
+    CHECK(hit.hit);
+    CHECK(hit.voxel == glm::ivec3(4, 2, 3));
+    // Crosses y = 2 at z = 3.5, entering through the bottom face.
+    CHECK(hit.normal == glm::ivec3(0, -1, 0));
+    CHECK(Near(hit.distance, 4.0f * std::sqrt(2.0f)));
+}
+
+static void TestMisses() {
+    CHECK(!Cast(glm::vec3(-2.0f, 2.5f, 3.5f), glm::vec3(-1.0f, 0.0f, 0.0f)).hit);
+    CHECK(!Cast(glm::vec3(-2.0f, 5.5f, 3.5f), glm::vec3(1.0f, 0.0f, 0.0f)).hit);
+    CHECK(!Cast(glm::vec3(-2.0f, 20.0f, 3.5f), glm::vec3(1.0f, 0.0f, 0.0f)).hit);
+    // The voxel starts 6 units along the ray.
+    CHECK(!Cast(glm::vec3(-2.0f, 2.5f, 3.5f), glm::vec3(1.0f, 0.0f, 0.0f), 5.5f).hit);
+    CHECK(Cast(glm::vec3(-2.0f, 2.5f, 3.5f), glm::vec3(1.0f, 0.0f, 0.0f), 6.5f).hit);
+}
+
+static void TestOverlapBox() {
+    CHECK(OverlapBox({glm::vec3(3.5f, 1.5f, 2.5f), glm::vec3(4.5f, 2.5f, 3.5f)}));
+    CHECK(!OverlapBox({glm::vec3(0.0f), glm::vec3(4.0f, 8.0f, 8.0f)}));
+    CHECK(!OverlapBox({glm::vec3(5.0f, 0.0f, 0.0f), glm::vec3(8.0f)}));
+    // Parts outside the grid are empty.
+    CHECK(OverlapBox({glm::vec3(-10.0f), glm::vec3(4.1f, 2.1f, 3.1f)}));
+    CHECK(!OverlapBox({glm::vec3(-10.0f), glm::vec3(-1.0f)}));
+}
+
+static void TestUpdateCopiesOnlyBox() {
+    std::vector<int> voxels(Size * Size * Size, 0);
+    voxels[Index(4, 2, 3)] = 7;
+    voxels[Index(1, 1, 1)] = 3;
+    voxels[Index(6, 6, 6)] = 9;
+
+    UpdateWorldVoxels(voxels, glm::ivec3(0), glm::ivec3(2));
+    CHECK(GetWorldVoxel(glm::ivec3(1, 1, 1)) == 3);
+    CHECK(GetWorldVoxel(glm::ivec3(6, 6, 6)) == 0);
+
+    // Boxes are clamped to the grid.
+    UpdateWorldVoxels(voxels, glm::ivec3(5), glm::ivec3(100));
+    CHECK(GetWorldVoxel(glm::ivec3(6, 6, 6)) == 9);
+
+    voxels[Index(1, 1, 1)] = 0;
+    voxels[Index(6, 6, 6)] = 0;
+    UpdateWorldVoxels(voxels, glm::ivec3(0), glm::ivec3(Size));
+    CHECK(GetWorldVoxel(glm::ivec3(1, 1, 1)) == 0);
+    CHECK(GetWorldVoxel(glm::ivec3(4, 2, 3)) == 7);
+}
+
+static void TestBatchesMatchSingleQueries() {
+    std::vector<RayQuery> rays;
+    std::vector<BoxQuery> boxes;
+    for (int i = 0; i < 1000; i++) {
+        float a = (float)i * 0.37f;
+        glm::vec3 origin(-4.0f, 2.5f + std::sin(a), 3.5f + std::cos(1.7f * a));
+        rays.push_back({origin, glm::normalize(glm::vec3(1.0f, 0.05f * std::sin(3.0f * a), 0.05f * std::cos(5.0f * a))), FLT_MAX});
+
+        glm::vec3 min(std::fmod(a, 7.0f), std::fmod(2.0f * a, 7.0f), std::fmod(3.0f * a, 7.0f));
+        boxes.push_back({min, min + 1.5f});
+    }
+
+    std::vector<RayHit> hits;
+    std::vector<uint8_t> overlaps;
+    CastRays(rays, hits);
+    OverlapBoxes(boxes, overlaps);
+    CHECK(hits.size() == rays.size());
+    CHECK(overlaps.size() == boxes.size());
+
+    uint32_t hitCount = 0;
+    for (size_t i = 0; i < rays.size(); i++) {
+        RayHit single = CastRay(rays[i]);
+        CHECK(hits[i].hit == single.hit);
+        CHECK(hits[i].voxel == single.voxel);
+        CHECK(hits[i].distance == single.distance);
+        CHECK((overlaps[i] != 0) == OverlapBox(boxes[i]));
+        hitCount += single.hit ? 1 : 0;
+    }
+    CHECK(hitCount > 0 && hitCount < rays.size());
+}
+
+int main() {
+    InitializeJobSystem(3);
+
+    // One voxel of material 7 at (4, 2, 3).
+    std::vector<int> voxels(Size * Size * Size, 0);
+    voxels[Index(4, 2, 3)] = 7;
+    SetWorldVoxels(glm::ivec3(Size), voxels);
+
+    TestGetVoxel();
+    TestAxisRays();
+    TestStartInsideSolid();
+    TestDiagonalRay();
+    TestMisses();
+    TestOverlapBox();
+    TestUpdateCopiesOnlyBox();
+    TestBatchesMatchSingleQueries();
+
+    ShutdownJobSystem();
+    return CheckFailures() == 0 ? 0 : 1;
+}